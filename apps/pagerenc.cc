@@ -0,0 +1,339 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+// Offline batch encoder: reads page commands in the PDU text format (one
+// per line; blank lines and lines starting with '#' are skipped) and writes
+// the transmissions back to back to a file, with no flowgraph or SDR.
+//
+// Output formats:
+//   bits  packed bits, one per baud symbol, MSB first (as in lib/golden/).
+//         Pages at different baud rates are simply concatenated.
+//   play  a file for flexencode's "play" command: a header (see render.h)
+//         and the bits of every page, run together.  All the pages have to
+//         be at the same baud rate, and -o is needed (the header is
+//         written last).
+//   int8  one -1/+1 symbol per byte at the output rate
+//   cf32  complex float FM baseband at the output rate (4800 Hz deviation
+//         for FLEX, 4500 Hz for POCSAG, unless -d is given)
+//
+// The output rate (-r) has to be a multiple of every page's baud rate.
+// Pages are encoded in parallel (-j threads) and written in input order.
+//
+// Usage: pagerenc [-f bits|play|int8|cf32] [-r rate] [-d deviation] [-j threads]
+//                 [-o output] [commandfile]
+
+#include <gnuradio/mixalot/fskmod.h>
+#include <gnuradio/mixalot/render.h>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+using std::vector;
+using gr::mixalot::render_page;
+using gr::mixalot::render_symrate;
+
+enum output_format { FORMAT_BITS, FORMAT_PLAY, FORMAT_INT8, FORMAT_CF32 };
+
+struct options {
+    output_format format;
+    unsigned long rate;         // output rate for int8/cf32
+    double deviation;           // cf32 deviation (0 = per protocol)
+    unsigned int threads;
+};
+
+// One page: its command, and the rendered output once a worker is done.
+struct job {
+    string cmd;
+    unsigned int lineno;
+    bool done;
+    bool ok;
+    string error;               // why it failed
+    vector<char> out;
+    size_t nbits;               // bits in out (bits and play formats)
+    unsigned int baudrate;
+};
+
+// Runs pages' bits together for -f play, with no padding between them (a
+// page needn't be a whole number of bytes).
+struct bit_packer {
+    uint8_t partial;            // bits of the next byte so far, MSB first
+    unsigned int npartial;
+    uint64_t nbits;             // bits appended in all
+
+    bit_packer() : partial(0), npartial(0), nbits(0) { }
+
+    // Append the first n bits of packed, adding the bytes completed to out.
+    void append(const vector<char> &packed, size_t n, vector<char> &out) {
+        for(size_t i = 0; i < n; i++) {
+            partial |= ((packed[i / 8] >> (7 - i % 8)) & 1) << (7 - npartial);
+            if(++npartial == 8) {
+                out.push_back(partial);
+                partial = 0;
+                npartial = 0;
+            }
+        }
+        nbits += n;
+    }
+};
+
+// Render one page into the output format, straight from its packed bits.
+static bool
+render_job(const options &opts, job &j) {
+    gr::mixalot::core::encoded_page page;
+    if(!render_page(j.cmd, page)) {
+        j.error = "can't encode";
+        return false;
+    }
+    const unsigned int baud = page.baudrate;
+    const size_t nbits = page.nbits;
+    j.nbits = nbits;
+    j.baudrate = baud;
+
+    if(opts.format == FORMAT_BITS || opts.format == FORMAT_PLAY) {
+        j.out.assign(page.bits.begin(), page.bits.begin() + (nbits + 7) / 8);
+        return true;
+    }
+
+    if(opts.rate == 0 || opts.rate % baud != 0) {
+        j.error = "rate " + std::to_string(opts.rate) + " is not a multiple of " + std::to_string(baud) + " baud";
+        return false;
+    }
+    const unsigned int interp = opts.rate / baud;
+    if(opts.format == FORMAT_INT8) {
+        j.out.resize(nbits * interp);
+        for(size_t i = 0; i < nbits; i++) {
+            std::fill(j.out.begin() + i * interp, j.out.begin() + (i + 1) * interp, page.bit(i) ? 1 : -1);
+        }
+        return true;
+    }
+
+    // cf32: modulate at the baud rate, interpolated up to the output rate.
+    const double deviation = (opts.deviation > 0) ? opts.deviation : (baud == 1600 ? 4800.0 : 4500.0);
+    gr::mixalot::fskmod::sptr mod = gr::mixalot::fskmod::make(opts.rate, interp, deviation,
+            gr::mixalot::fskmod::None, 0.5, baud, 1.0);
+    // The modulator looks back history() - 1 symbols; start with the carrier off.
+    const size_t lead = mod->history() - 1;
+    vector<int8_t> in(lead + nbits, 0);
+    for(size_t i = 0; i < nbits; i++) {
+        in[lead + i] = page.bit(i) ? 1 : -1;
+    }
+    j.out.resize(nbits * interp * sizeof(gr_complex));
+    gr_vector_const_void_star input_items(1, &in[0]);
+    gr_vector_void_star output_items(1, &j.out[0]);
+    mod->work(nbits * interp, input_items, output_items);
+    return true;
+}
+
+static void
+usage(const char *prog) {
+    std::cerr << "usage: " << prog << " [-f bits|play|int8|cf32] [-r rate] [-d deviation] [-j threads]"
+        << " [-o output] [commandfile]" << std::endl;
+}
+
+int
+main(int argc, char **argv) {
+    options opts;
+    opts.format = FORMAT_INT8;
+    opts.rate = render_symrate;
+    opts.deviation = 0;
+    opts.threads = std::max(1u, std::thread::hardware_concurrency());
+    string outpath = "-";
+    string inpath = "-";
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            const string f = argv[++i];
+            if(f == "bits") {
+                opts.format = FORMAT_BITS;
+            } else if(f == "play") {
+                opts.format = FORMAT_PLAY;
+            } else if(f == "int8") {
+                opts.format = FORMAT_INT8;
+            } else if(f == "cf32") {
+                opts.format = FORMAT_CF32;
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if(strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            opts.rate = strtoul(argv[++i], 0, 10);
+        } else if(strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            opts.deviation = strtod(argv[++i], 0);
+        } else if(strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            opts.threads = std::max(1ul, strtoul(argv[++i], 0, 10));
+        } else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outpath = argv[++i];
+        } else if(argv[i][0] != '-' || strcmp(argv[i], "-") == 0) {
+            inpath = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::ifstream infile;
+    if(inpath != "-") {
+        infile.open(inpath.c_str());
+        if(!infile) {
+            std::cerr << inpath << ": " << strerror(errno) << std::endl;
+            return 1;
+        }
+    }
+    std::istream &in = (inpath == "-") ? std::cin : infile;
+    vector<job> jobs;
+    string line;
+    for(unsigned int lineno = 1; std::getline(in, line); lineno++) {
+        const size_t start = line.find_first_not_of(" \t\r");
+        if(start == string::npos || line[start] == '#') {
+            continue;
+        }
+        job j;
+        j.cmd = line;
+        j.lineno = lineno;
+        j.done = false;
+        j.ok = false;
+        j.nbits = 0;
+        j.baudrate = 0;
+        jobs.push_back(j);
+    }
+
+    if(opts.format == FORMAT_PLAY && outpath == "-") {
+        std::cerr << "-f play needs an output file (-o)" << std::endl;
+        return 1;
+    }
+    FILE *out = (outpath == "-") ? stdout : fopen(outpath.c_str(), "wb");
+    if(out == NULL) {
+        std::cerr << outpath << ": " << strerror(errno) << std::endl;
+        return 1;
+    }
+    // Room for the play header, filled in once the length is known.
+    uint8_t header[gr::mixalot::play_header_bytes] = { 0 };
+    if(opts.format == FORMAT_PLAY && fwrite(header, 1, sizeof(header), out) != sizeof(header)) {
+        std::cerr << outpath << ": " << strerror(errno) << std::endl;
+        fclose(out);
+        return 1;
+    }
+    bit_packer packer;
+    unsigned int play_baud = 0;
+
+    // Workers take pages in order; the main thread writes them out in
+    // order and frees them.  A worker doesn't get more than `window` pages
+    // ahead of the writer, which bounds memory for large cf32 runs.
+    const size_t window = opts.threads * 4;
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t next = 0;            // next page to hand to a worker
+    size_t written = 0;         // pages written so far
+    bool stop = false;          // the writer failed; workers quit
+
+    auto worker = [&]() {
+        for(;;) {
+            size_t idx;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&] { return stop || next >= jobs.size() || next < written + window; });
+                if(stop || next >= jobs.size()) {
+                    return;
+                }
+                idx = next++;
+            }
+            job &j = jobs[idx];
+            bool ok = false;
+            try {
+                ok = render_job(opts, j);
+            } catch(const std::exception &e) {
+                j.error = e.what();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            j.ok = ok;
+            j.done = true;
+            cond.notify_all();
+        }
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    vector<std::thread> threads;
+    for(unsigned int i = 0; i < opts.threads; i++) {
+        threads.push_back(std::thread(worker));
+    }
+
+    unsigned long failed = 0;
+    unsigned long long bytes = 0;
+    bool write_error = false;
+    for(size_t i = 0; i < jobs.size() && !write_error; i++) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&] { return jobs[i].done; });
+        }
+        job &j = jobs[i];
+        if(j.ok && opts.format == FORMAT_PLAY) {
+            if(play_baud == 0) {
+                play_baud = j.baudrate;
+            }
+            if(j.baudrate != play_baud) {
+                j.ok = false;
+                j.error = std::to_string(j.baudrate) + " baud, but the file is " + std::to_string(play_baud);
+            } else {
+                vector<char> run;
+                packer.append(j.out, j.nbits, run);
+                j.out.swap(run);
+            }
+        }
+        if(!j.ok) {
+            std::cerr << "line " << j.lineno << ": " << j.error << ": " << j.cmd << std::endl;
+            failed++;
+        } else if(!j.out.empty() && fwrite(&j.out[0], 1, j.out.size(), out) != j.out.size()) {
+            std::cerr << outpath << ": " << strerror(errno) << std::endl;
+            write_error = true;
+        }
+        bytes += j.out.size();
+        vector<char>().swap(j.out);
+        std::lock_guard<std::mutex> lock(mutex);
+        written++;
+        stop = write_error;
+        cond.notify_all();
+    }
+    for(auto &t : threads) {
+        t.join();
+    }
+    if(opts.format == FORMAT_PLAY && !write_error) {
+        gr::mixalot::make_play_header(play_baud, packer.nbits, header);
+        const char last = packer.partial;
+        if((packer.npartial > 0 && fwrite(&last, 1, 1, out) != 1) || fseek(out, 0, SEEK_SET) != 0
+                || fwrite(header, 1, sizeof(header), out) != sizeof(header)) {
+            std::cerr << outpath << ": " << strerror(errno) << std::endl;
+            write_error = true;
+        }
+        bytes += sizeof(header) + (packer.npartial > 0);
+    }
+    if(out != stdout) {
+        if(fclose(out) != 0 && !write_error) {
+            std::cerr << outpath << ": " << strerror(errno) << std::endl;
+            write_error = true;
+        }
+    } else {
+        fflush(out);
+    }
+    if(write_error) {
+        return 1;
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << jobs.size() - failed << " pages encoded, " << failed << " failed, "
+        << bytes << " bytes in " << elapsed << " s" << std::endl;
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,207 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+// End-to-end throughput benchmark for the PDU pager server.
+//
+// Builds flexencode -> null sink in a top block, posts synthetic command
+// PDUs (a mix of FLEX and POCSAG, alpha and numeric, short and long
+// messages) straight to the encoder's "beeps" port, and collects the
+// responses from "beeps_output".  Nothing is throttled, so the numbers are
+// what one core can encode and stream, without an SDR or network.
+//
+// Two phases:
+//   - latency: one command at a time, timed from post to ack
+//   - throughput: post everything at once, wait for all the acks
+//
+// Usage: pagerserver_bench [-n commands] [-l latency_commands] [-s seed]
+
+#include <gnuradio/top_block.h>
+#include <gnuradio/blocks/null_sink.h>
+#include <gnuradio/mixalot/flexencode.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+typedef std::chrono::steady_clock bench_clock;
+
+// Collects responses from the encoder's beeps_output port.
+class ack_sink : public gr::block
+{
+private:
+    std::mutex d_mutex;
+    std::condition_variable d_cond;
+    unsigned long d_ok;
+    unsigned long d_failed;
+
+    void handle(pmt::pmt_t msg) {
+        pmt::pmt_t body = pmt::cdr(msg);
+        if(!pmt::is_u8vector(body)) {
+            return;
+        }
+        const vector<uint8_t> chars = pmt::u8vector_elements(body);
+        const string line(chars.begin(), chars.end());
+        std::lock_guard<std::mutex> lock(d_mutex);
+        if(line.find(" OK") != string::npos) {
+            d_ok++;
+        } else if(line.find(" ERROR") != string::npos || line.find(" BUSY") != string::npos) {
+            d_failed++;
+        } else {
+            return;
+        }
+        d_cond.notify_all();
+    }
+
+public:
+    ack_sink()
+      : gr::block("ack_sink", gr::io_signature::make(0, 0, 0), gr::io_signature::make(0, 0, 0)),
+        d_ok(0), d_failed(0)
+    {
+        message_port_register_in(pmt::mp("in"));
+        set_msg_handler(pmt::mp("in"), [this](pmt::pmt_t msg) { this->handle(msg); });
+    }
+
+    // Block until `count` responses (of any kind) have arrived in total.
+    void wait_for(unsigned long count) {
+        std::unique_lock<std::mutex> lock(d_mutex);
+        d_cond.wait(lock, [this, count] { return d_ok + d_failed >= count; });
+    }
+
+    unsigned long ok() { std::lock_guard<std::mutex> lock(d_mutex); return d_ok; }
+    unsigned long failed() { std::lock_guard<std::mutex> lock(d_mutex); return d_failed; }
+};
+
+static string
+hex_encode(const string &s) {
+    string out;
+    char buf[3];
+    for(size_t i = 0; i < s.length(); i++) {
+        snprintf(buf, sizeof(buf), "%02x", (unsigned char)s[i]);
+        out += buf;
+    }
+    return out;
+}
+
+// Build a random command in the PDU text format.
+static string
+make_command(std::mt19937 &rng, unsigned long tag) {
+    static const char *protocols[] = { "flex", "pocsag512", "pocsag1200", "pocsag2400" };
+    static const char *alphachars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789 .,-";
+    static const char *numchars = "0123456789 -U";
+    const string protocol = protocols[rng() % 4];
+    const bool alpha = (rng() % 2) == 0;
+    // Keep within each protocol's limits: FLEX numeric tops out at 41 digits.
+    const unsigned int maxlen = alpha ? 200 : 40;
+    const unsigned int len = 1 + rng() % maxlen;
+    string msg;
+    for(unsigned int i = 0; i < len; i++) {
+        if(alpha) {
+            msg += alphachars[rng() % strlen(alphachars)];
+        } else {
+            msg += numchars[rng() % strlen(numchars)];
+        }
+    }
+    const unsigned long capcode = (protocol == "flex") ? (1 + rng() % 1900000) : (rng() % 2000000);
+    return protocol + " " + std::to_string(tag) + " 931337500 " + (alpha ? "alpha " : "numeric ")
+        + std::to_string(capcode) + " " + hex_encode(msg);
+}
+
+static pmt::pmt_t
+make_pdu(const string &cmd) {
+    return pmt::cons(pmt::make_dict(), pmt::init_u8vector(cmd.length(), (const uint8_t *)cmd.c_str()));
+}
+
+static double
+percentile(vector<double> &sorted, double pct) {
+    if(sorted.empty()) {
+        return 0;
+    }
+    size_t idx = (size_t)(pct / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+int
+main(int argc, char **argv) {
+    unsigned long ncommands = 2000;
+    unsigned long nlatency = 200;
+    unsigned long seed = 1;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            ncommands = strtoul(argv[++i], 0, 10);
+        } else if(strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            nlatency = strtoul(argv[++i], 0, 10);
+        } else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], 0, 10);
+        } else {
+            std::cerr << "usage: " << argv[0] << " [-n commands] [-l latency_commands] [-s seed]" << std::endl;
+            return 1;
+        }
+    }
+
+    gr::top_block_sptr tb = gr::make_top_block("pagerserver_bench");
+    // No admission limits: we want to measure the encoder, not the backpressure.
+    gr::mixalot::flexencode::sptr enc = gr::mixalot::flexencode::make(0, 0, 0);
+    gr::blocks::null_sink::sptr sink = gr::blocks::null_sink::make(sizeof(unsigned char));
+    std::shared_ptr<ack_sink> acks = gnuradio::make_block_sptr<ack_sink>();
+    tb->connect(enc, 0, sink, 0);
+    tb->msg_connect(enc, "beeps_output", acks, "in");
+    tb->start();
+
+    std::mt19937 rng(seed);
+    unsigned long tag = 0;
+
+    // Latency phase: one at a time.
+    vector<double> latencies;
+    for(unsigned long i = 0; i < nlatency; i++) {
+        const pmt::pmt_t pdu = make_pdu(make_command(rng, tag++));
+        const bench_clock::time_point start = bench_clock::now();
+        enc->_post(pmt::mp("beeps"), pdu);
+        acks->wait_for(tag);
+        latencies.push_back(std::chrono::duration<double, std::milli>(bench_clock::now() - start).count());
+    }
+    const uint64_t samples_before = enc->nitems_written(0);
+
+    // Throughput phase: everything at once.  PDUs are built up front so
+    // only the encoder is being timed.
+    vector<pmt::pmt_t> pdus;
+    for(unsigned long i = 0; i < ncommands; i++) {
+        pdus.push_back(make_pdu(make_command(rng, tag + i)));
+    }
+    const bench_clock::time_point start = bench_clock::now();
+    for(auto it = pdus.begin(); it != pdus.end(); it++) {
+        enc->_post(pmt::mp("beeps"), *it);
+    }
+    acks->wait_for(tag + ncommands);
+    const double elapsed = std::chrono::duration<double>(bench_clock::now() - start).count();
+    const uint64_t samples = enc->nitems_written(0) - samples_before;
+
+    tb->stop();
+    tb->wait();
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::sort(latencies.begin(), latencies.end());
+
+    printf("commands:          %lu (%lu ok, %lu failed)\n", ncommands + nlatency, acks->ok(), acks->failed());
+    printf("commands/sec:      %.1f\n", ncommands / elapsed);
+    printf("samples/sec:       %.3e\n", samples / elapsed);
+    printf("latency p50 (ms):  %.3f\n", percentile(latencies, 50));
+    printf("latency p90 (ms):  %.3f\n", percentile(latencies, 90));
+    printf("latency p99 (ms):  %.3f\n", percentile(latencies, 99));
+    printf("latency max (ms):  %.3f\n", percentile(latencies, 100));
+    printf("peak RSS (MiB):    %.1f\n", usage.ru_maxrss / 1024.0);
+    return 0;
+}
@@ -0,0 +1,103 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_CORE_H
+#define INCLUDED_MIXALOT_CORE_H
+
+// The page encoders, without GNU Radio.  This header (and the mixalot-core
+// library behind it) depends only on the C++ standard library, so pages can
+// be encoded and sized anywhere; the encoder blocks are built on it.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#  ifdef mixalot_core_EXPORTS
+#    define MIXALOT_CORE_API __declspec(dllexport)
+#  else
+#    define MIXALOT_CORE_API __declspec(dllimport)
+#  endif
+#else
+#  define MIXALOT_CORE_API __attribute__((visibility("default")))
+#endif
+
+namespace gr {
+  namespace mixalot {
+    namespace core {
+
+      enum protocol_t {
+          FLEX = 0,             // FLEX, 1600 bps 2-level, one frame
+          POCSAG512,
+          POCSAG1200,
+          POCSAG2400,
+          GSC,                  // Golay Sequential Code, 600 bps
+      };
+
+      //! Same values as the blocks' msgtype_t.  Auto sends the page as
+      //! numeric if the message is all numeric characters and that takes
+      //! fewer code words, otherwise as alpha.
+      enum msgtype_t { Numeric = 0, Alpha = 1, Auto = 2 };
+
+      /*!
+       * \brief A page to encode.
+       *
+       * FLEX and POCSAG pages may have several capcodes (all of them get
+       * the message, in one transmission); GSC uses only the first.  The
+       * message is plain text.
+       */
+      struct page {
+          protocol_t protocol;
+          msgtype_t type;
+          std::vector<uint32_t> capcodes;
+          std::string message;
+      };
+
+      /*!
+       * \brief An encoded page, as packed bits.
+       *
+       * One bit per baud symbol, MSB first, 1 for a +1 symbol: the same
+       * format the flexencode block queues and pagerenc -f bits writes.
+       */
+      struct encoded_page {
+          std::vector<uint8_t> bits;
+          size_t nbits;
+          unsigned int baudrate;
+          size_t codewords;     //!< code words sent, including sync and idle words
+          msgtype_t type;       //!< type sent (Numeric or Alpha, even for an Auto page)
+          double auto_saved;    //!< Auto pages: seconds of airtime saved over sending it as Alpha
+
+          encoded_page() : nbits(0), baudrate(0), codewords(0), type(Alpha), auto_saved(0) { }
+          bool bit(size_t i) const { return (bits[i >> 3] >> (7 - (i & 7))) & 1; }
+          //! Time on the air, in seconds
+          double seconds() const { return baudrate ? (double)nbits / baudrate : 0.0; }
+      };
+
+      /*!
+       * \brief Encode a page.
+       *
+       * Replaces \p out.  Returns false, with the reason in \p error (if
+       * given), if the page can't be encoded: an unknown type, a capcode
+       * the protocol can't address, or a message that's too long or has
+       * characters the type can't carry.
+       *
+       * Pure and reentrant: pages can be encoded on any number of threads
+       * at once.
+       */
+      MIXALOT_CORE_API bool encode(const page &pg, encoded_page &out, std::string *error = 0);
+
+      //! Parse a protocol name as used in flexencode commands ("flex",
+      //! "pocsag512", "pocsag1200", "pocsag2400" or "gsc").
+      MIXALOT_CORE_API bool parse_protocol(const std::string &name, protocol_t &protocol);
+      MIXALOT_CORE_API const char *protocol_name(protocol_t protocol);
+      MIXALOT_CORE_API unsigned int protocol_baudrate(protocol_t protocol);
+
+    } // namespace core
+  } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_CORE_H */
@@ -9,6 +9,8 @@
 
 #include <gnuradio/mixalot/api.h>
 #include <gnuradio/sync_block.h>
+#include <string>
+#include <vector>
 
 namespace gr {
   namespace mixalot {
@@ -18,9 +20,86 @@ namespace gr {
     {
     public:
        typedef std::shared_ptr<flexencode> sptr;
-       typedef enum { Numeric = 0, Alpha = 1 } msgtype_t;
+       typedef enum { Numeric = 0, Alpha = 1, Auto = 2 } msgtype_t;
 
-       static sptr make();
+       /*!
+        * Admission limits for the PDU server.  A command that arrives while
+        * any limit is reached is answered with "<tag> BUSY <retry-after-ms>"
+        * instead of being queued.  A value of 0 disables that limit.
+        *
+        * With an empty channel map the block has a single output and retunes
+        * the transmitter between pages.  With N entries in the channel map it
+        * has N outputs, one per frequency; each command is routed to the
+        * output whose frequency matches, and outputs with nothing to send
+        * emit 0 while others are busy.
+        *
+        * \param max_queue_seconds  maximum queued airtime, in seconds
+        * \param max_queue_pages    maximum number of accepted pages not yet acked
+        * \param max_queue_bytes    maximum memory used by queued pages
+        * \param channel_freqs      channel map: frequency (Hz) of each output
+        * \param stats_interval     seconds between PDUs on the stats port (0 = never)
+        * \param trace_depth        records kept in the binary trace ring (0 = no tracing)
+        * \param playback_dir       directory the "play" command may read pre-rendered
+        *                           files from (empty = playback disabled)
+        * \param cache_bytes        memory for recently encoded pages, reused when
+        *                           the same page is sent again (0 = no cache)
+        * \param journal_path       file to journal accepted pages in, so that pages
+        *                           not yet acked are sent again after a restart
+        *                           (empty = no journal)
+        * \param encode_threads     threads to encode pages on, so that big batches
+        *                           don't hold up the message thread; pages are
+        *                           still queued in the order they arrived
+        *                           (0 = encode on the message thread)
+        * \param page_ttl           seconds a page may wait to go on the air before
+        *                           it's dropped, unless the command gives its own
+        *                           (0 = no limit)
+        * \param dedup_window       seconds during which a page with the same
+        *                           protocol, message type, channel, capcodes
+        *                           and message as an earlier one is turned
+        *                           away as a duplicate (0 = never)
+        * \param retune_messages    also publish each retune as a "freq" command on
+        *                           cmds_out, for sinks that can't retune from the
+        *                           tx_freq tag.  The message goes out when the
+        *                           page is dequeued, not when its first sample is
+        *                           sent, so the previous page may still be on the
+        *                           air (default off)
+        */
+       static sptr make(double max_queue_seconds = 600.0,
+                        unsigned int max_queue_pages = 1000,
+                        unsigned long max_queue_bytes = 256 * 1024 * 1024,
+                        const std::vector<double> &channel_freqs = std::vector<double>(),
+                        double stats_interval = 0.0,
+                        unsigned int trace_depth = 0,
+                        const std::string &playback_dir = "",
+                        unsigned long cache_bytes = 16 * 1024 * 1024,
+                        const std::string &journal_path = "",
+                        unsigned int encode_threads = 0,
+                        double page_ttl = 0.0,
+                        double dedup_window = 0.0,
+                        bool retune_messages = false);
+
+       /*!
+        * Performance counters.  These are also registered with ControlPort
+        * when GNU Radio is built with it, and published periodically on the
+        * stats port.  stats() returns all of them, including the histograms,
+        * as a dictionary.
+        */
+       virtual long pages_accepted() const = 0;
+       virtual long pages_rejected() const = 0;
+       virtual long codewords_encoded() const = 0;
+       virtual long queued_samples() const = 0;
+       virtual double queued_airtime() const = 0;
+       virtual long idle_work_calls() const = 0;
+       virtual long cache_hits() const = 0;
+       virtual long cache_misses() const = 0;
+       virtual pmt::pmt_t stats() const = 0;
+
+       /*!
+        * Write the trace ring (see trace_depth) to a file, oldest record
+        * first.  Returns false if tracing is off or the file can't be
+        * written.
+        */
+       virtual bool dump_trace(const std::string &filename) const = 0;
     };
 
   } // namespace mixalot
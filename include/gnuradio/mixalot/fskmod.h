@@ -0,0 +1,58 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_FSKMOD_H
+#define INCLUDED_MIXALOT_FSKMOD_H
+
+#include <gnuradio/mixalot/api.h>
+#include <gnuradio/sync_interpolator.h>
+
+namespace gr {
+  namespace mixalot {
+
+    /*!
+     * \brief Symbols to complex baseband FSK modulator.
+     * \ingroup mixalot
+     *
+     * Takes the -1/+1 symbol stream from one of the encoders and produces
+     * FM-modulated complex samples at \p interpolation times the symbol
+     * rate, scaled by \p amplitude.  This does the work of the usual
+     * char-to-float, frequency modulator and multiply-const chain (and the
+     * resampler, as long as the SDR rate is an integer multiple of the
+     * symbol rate) in one pass.  A 0 symbol keys the carrier off.
+     *
+     * The frequency can optionally be shaped with a Gaussian filter (\p bt
+     * is the bandwidth-time product) or a raised-cosine filter (\p bt is
+     * the rolloff); \p baudrate sets the filter's time scale.
+     */
+    class MIXALOT_API fskmod : virtual public gr::sync_interpolator
+    {
+    public:
+       typedef std::shared_ptr<fskmod> sptr;
+       typedef enum { None = 0, Gaussian = 1, RaisedCosine = 2 } shaping_t;
+
+       /*!
+        * \param samp_rate      output sample rate (Hz)
+        * \param interpolation  output samples per input symbol
+        * \param deviation      peak deviation (Hz); 4500 for POCSAG, 4800 for FLEX
+        * \param shaping        frequency shaping filter (shaping_t)
+        * \param bt             Gaussian BT product, or raised-cosine rolloff
+        * \param baudrate       baud rate of the signal, used to size the filter
+        * \param amplitude      output amplitude
+        */
+       static sptr make(double samp_rate = 998400,
+                        unsigned int interpolation = 26,
+                        double deviation = 4800.0,
+                        int shaping = None,
+                        double bt = 0.5,
+                        double baudrate = 1600,
+                        float amplitude = 1.0);
+    };
+
+  } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_FSKMOD_H */
@@ -0,0 +1,49 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_FSKSYNTH_H
+#define INCLUDED_MIXALOT_FSKSYNTH_H
+
+#include <gnuradio/mixalot/api.h>
+#include <gnuradio/sync_interpolator.h>
+#include <vector>
+
+namespace gr {
+  namespace mixalot {
+
+    /*!
+     * \brief Multi-carrier FSK synthesizer for simultaneous paging channels.
+     * \ingroup mixalot
+     *
+     * Takes one symbol stream per channel (the -1/+1 output of the encoders;
+     * 0 means "carrier off") and produces the composite complex baseband of
+     * all channels, each FM-modulated at its own offset from the center
+     * frequency.  Every input symbol becomes \p interpolation output samples,
+     * so the output rate is \p interpolation times the encoders' symbol rate.
+     *
+     * Each channel's amplitude is 1/N, so the composite never exceeds 1.0.
+     */
+    class MIXALOT_API fsksynth : virtual public gr::sync_interpolator
+    {
+    public:
+       typedef std::shared_ptr<fsksynth> sptr;
+
+       /*!
+        * \param samp_rate      output sample rate (Hz)
+        * \param interpolation  output samples per input symbol
+        * \param freq_offsets   offset of each channel from the center frequency (Hz)
+        * \param deviation      peak FSK deviation (Hz)
+        */
+       static sptr make(double samp_rate = 998400,
+                        unsigned int interpolation = 26,
+                        const std::vector<double> &freq_offsets = std::vector<double>(1, 0.0),
+                        double deviation = 4800.0);
+    };
+
+  } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_FSKSYNTH_H */
@@ -16,13 +16,18 @@
 
 namespace gr {
   namespace mixalot {
+    /*!
+     * GSC encoder: sends one page, or runs continuously.  Pages can be sent
+     * to the "pages" message port and the persistent flag works the same
+     * way as in pocencode.
+     */
     class MIXALOT_API gscencode : virtual public sync_block
     {
     public:
        typedef std::shared_ptr<gscencode> sptr;
-       typedef enum { Numeric = 0, Alpha = 1 } msgtype_t;
+       typedef enum { Numeric = 0, Alpha = 1, Auto = 2 } msgtype_t;
 
-       static sptr make(int type=0, unsigned int capcode = 0, std::string message="", unsigned long symrate = 38400);
+       static sptr make(int type=0, unsigned int capcode = 0, std::string message="", unsigned long symrate = 38400, bool persistent = false);
     };
 
   } // namespace mixalot
@@ -0,0 +1,58 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_PAGERDECODE_H
+#define INCLUDED_MIXALOT_PAGERDECODE_H
+
+#include <gnuradio/mixalot/api.h>
+#include <gnuradio/sync_block.h>
+
+namespace gr {
+  namespace mixalot {
+
+    /*!
+     * \brief POCSAG/FLEX/GSC decoder, for monitoring the encoders' output.
+     * \ingroup mixalot
+     *
+     * Takes a -1/+1 symbol stream at \p symrate (the same stream the
+     * encoders produce, or a demodulated one) and runs a decoder for each
+     * enabled protocol over it: POCSAG at 512, 1200 and 2400 baud, FLEX at
+     * 1600 and GSC at 600.  Each page found is published on the "pages"
+     * port as a PDU: the metadata dictionary has protocol, capcode, type
+     * ("alpha", "numeric" or "tone"), function (POCSAG only), corrected
+     * (bit errors corrected) and uncorrectable (codewords that couldn't
+     * be), and the data is the message text.
+     *
+     * A packed bitstream (one bit per symbol, MSB first) can also be sent
+     * to the "bits" port as a PDU with "protocol" in its metadata; the
+     * pages in it are published the same way.
+     */
+    class MIXALOT_API pagerdecode : virtual public gr::sync_block
+    {
+    public:
+       typedef std::shared_ptr<pagerdecode> sptr;
+
+       /*!
+        * \param symrate    input symbol rate (each protocol's baud rate must divide it)
+        * \param pocsag     decode POCSAG (all three baud rates)
+        * \param flex       decode FLEX
+        * \param gsc        decode GSC
+        */
+       static sptr make(unsigned long symrate = 38400, bool pocsag = true, bool flex = true, bool gsc = true);
+
+       /*!
+        * Counters: pages published, bit errors corrected, and codewords that
+        * had too many errors to correct, across all the decoders.
+        */
+       virtual long pages_decoded() const = 0;
+       virtual long corrected_errors() const = 0;
+       virtual long uncorrectable_words() const = 0;
+    };
+
+  } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_PAGERDECODE_H */
@@ -14,15 +14,23 @@ namespace gr {
   namespace mixalot {
 
     /*!
-     * \brief <+description of block+>
+     * \brief POCSAG encoder: sends one page, or runs continuously.
      * \ingroup mixalot
      *
+     * More pages can be sent to the "pages" message port as PDUs: the data
+     * is the message text, and the metadata may set "capcode" and "type"
+     * ("alpha", "numeric" or "auto"; both default to the block's
+     * parameters).
+     * Without persistent, the block finishes (and the flowgraph with it)
+     * once everything queued has been sent.  With persistent, it keeps
+     * running and waits for more pages; the page given to the constructor
+     * is then optional (it's only sent if message isn't empty).
      */
     class MIXALOT_API pocencode : virtual public gr::sync_block
     {
     public:
        typedef std::shared_ptr<pocencode> sptr;
-       typedef enum { Numeric = 0, Alpha = 1 } msgtype_t;
+       typedef enum { Numeric = 0, Alpha = 1, Auto = 2 } msgtype_t;
 
       /*!
        * \brief Return a shared_ptr to a new instance of mixalot::pocencode.
@@ -32,7 +40,7 @@ namespace gr {
        * class. mixalot::pocencode::make is the public interface for
        * creating new instances.
        */
-      static sptr make(int type=0, unsigned int baudrate = 1200, unsigned int capcode = 0, std::string message="", unsigned long symrate = 38400);
+      static sptr make(int type=0, unsigned int baudrate = 1200, unsigned int capcode = 0, std::string message="", unsigned long symrate = 38400, bool persistent = false);
     };
 
   } // namespace mixalot
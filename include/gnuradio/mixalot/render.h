@@ -0,0 +1,66 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_RENDER_H
+#define INCLUDED_MIXALOT_RENDER_H
+
+#include <gnuradio/mixalot/api.h>
+#include <gnuradio/mixalot/core.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace gr {
+  namespace mixalot {
+
+    /*!
+     * \brief Parse and encode one page command.
+     *
+     * \p cmd is a page command in the PDU text format accepted by
+     * flexencode ("<protocol> <tag> <frequency_hz> <alpha|numeric>
+     * <capcode> <hex message>").  On success, \p encoded holds its packed
+     * bits, one per baud symbol.  Returns false if the command isn't a
+     * page command or can't be encoded (the reason is logged).
+     */
+    MIXALOT_API bool render_page(const std::string &cmd, core::encoded_page &encoded);
+
+    /*!
+     * \brief Encode one page command without a flowgraph.
+     *
+     * \p cmd is a page command in the PDU text format accepted by
+     * flexencode ("<protocol> <tag> <frequency_hz> <alpha|numeric>
+     * <capcode> <hex message>").  On success, \p symbols holds the
+     * transmission exactly as flexencode would send it: one -1/+1 symbol
+     * per byte at flexencode's symbol rate (render_symrate), and \p
+     * baudrate is the protocol's baud rate.  Returns false if the command
+     * isn't a page command or can't be encoded (the reason is logged).
+     *
+     * Each call is independent, so pages can be rendered from several
+     * threads at once.
+     */
+    MIXALOT_API bool render_command(const std::string &cmd, std::vector<int8_t> &symbols, unsigned int &baudrate);
+
+    //! Symbol rate of render_command()'s output
+    static const unsigned long render_symrate = 38400;
+
+    /*!
+     * A file for flexencode's "play" command (pagerenc -f play) is a
+     * header of play_header_bytes -- "MXPB", then the baud rate (32 bits)
+     * and the number of bits (64 bits), both little-endian -- followed by
+     * exactly (nbits + 7) / 8 bytes of packed bits, MSB first.
+     */
+    static const size_t play_header_bytes = 16;
+
+    //! Fill in a play file header.
+    MIXALOT_API void make_play_header(unsigned int baudrate, uint64_t nbits, uint8_t *header);
+
+    //! Read a play file header; returns false if it isn't one.
+    MIXALOT_API bool parse_play_header(const uint8_t *header, unsigned int &baudrate, uint64_t &nbits);
+
+  } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_RENDER_H */
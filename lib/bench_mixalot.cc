@@ -0,0 +1,252 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+// Microbenchmarks for the encoding primitives and the blocks' work()
+// functions.  Built as bench_mixalot when Google Benchmark is available;
+// run with --benchmark_format=json (or --benchmark_out=<file>
+// --benchmark_out_format=json) to get machine-readable results.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include <gnuradio/mixalot/core.h>
+#include "utils.h"
+#include "golay.h"
+#include "flex_words.h"
+#include "flexencode_impl.h"
+#include "pocencode_impl.h"
+#include "gscencode_impl.h"
+#include "fskmod_impl.h"
+#include "fsksynth_impl.h"
+
+using namespace gr::mixalot;
+
+static const std::string numeric_msg = "0123456789U-[]0123456789 0123456789";
+static const std::string alpha_msg = "HACK THE PLANET. The quick brown fox jumps over the lazy dog 0123456789";
+
+static void
+BM_encodeword(benchmark::State &state) {
+    uint32_t dw = 0;
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(encodeword((dw++ & 0x1FFFFF) << 11));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_encodeword);
+
+static void
+BM_encodewords(benchmark::State &state) {
+    std::vector<uint32_t> in(state.range(0));
+    std::vector<uint32_t> out(in.size());
+    for(size_t i = 0; i < in.size(); i++) {
+        in[i] = (i & 0x1FFFFF) << 11;
+    }
+    for(auto _ : state) {
+        encodewords(in.data(), out.data(), in.size());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * in.size());
+}
+BENCHMARK(BM_encodewords)->Arg(16)->Arg(4096);
+
+static void
+BM_calcgolay(benchmark::State &state) {
+    unsigned long data = 0;
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(calcgolay(data++ & 0xfff));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_calcgolay);
+
+static void
+BM_make_numeric_message(benchmark::State &state) {
+    for(auto _ : state) {
+        std::vector<uint32_t> msgwords;
+        make_numeric_message(numeric_msg, msgwords);
+        benchmark::DoNotOptimize(msgwords.data());
+    }
+    state.SetBytesProcessed(state.iterations() * numeric_msg.length());
+}
+BENCHMARK(BM_make_numeric_message);
+
+static void
+BM_make_alpha_message(benchmark::State &state) {
+    for(auto _ : state) {
+        std::vector<uint32_t> msgwords;
+        make_alpha_message(alpha_msg, msgwords);
+        benchmark::DoNotOptimize(msgwords.data());
+    }
+    state.SetBytesProcessed(state.iterations() * alpha_msg.length());
+}
+BENCHMARK(BM_make_alpha_message);
+
+static void
+BM_interleave(benchmark::State &state) {
+    uint32_t words[8];
+    uint8_t interleaved[256];
+    uint32_t seed = 0x12345678;
+    for(auto _ : state) {
+        for(int i = 0; i < 8; i++) {
+            words[i] = seed;
+            seed = seed * 1664525 + 1013904223;
+        }
+        interleave(words, interleaved);
+        benchmark::DoNotOptimize(interleaved);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_interleave);
+
+static void
+BM_make_alphanumeric_msg(benchmark::State &state) {
+    std::string error;
+    for(auto _ : state) {
+        std::vector<uint32_t> vecwords, msgwords;
+        make_alphanumeric_msg(1, 3, alpha_msg, vecwords, msgwords, error);
+        benchmark::DoNotOptimize(msgwords.data());
+    }
+    state.SetBytesProcessed(state.iterations() * alpha_msg.length());
+}
+BENCHMARK(BM_make_alphanumeric_msg);
+
+// A whole page, straight from the core library.
+static void
+BM_core_encode(benchmark::State &state) {
+    core::page pg;
+    pg.protocol = (core::protocol_t)state.range(0);
+    pg.type = core::Alpha;
+    pg.capcodes.push_back(123456);
+    pg.message = alpha_msg;
+    for(auto _ : state) {
+        core::encoded_page encoded;
+        core::encode(pg, encoded);
+        benchmark::DoNotOptimize(encoded.bits.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_core_encode)->Arg(core::FLEX)->Arg(core::POCSAG1200)->Arg(core::GSC);
+
+static void
+BM_hex_decode(benchmark::State &state) {
+    std::string hex;
+    for(size_t i = 0; i < alpha_msg.length(); i++) {
+        char buf[3];
+        snprintf(buf, sizeof(buf), "%02x", (unsigned char)alpha_msg[i]);
+        hex += buf;
+    }
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(hex_decode(hex));
+    }
+    state.SetBytesProcessed(state.iterations() * hex.length());
+}
+BENCHMARK(BM_hex_decode);
+
+// Drain one block's output in noutput_items-sized chunks.  refill() is
+// called (outside of the timed region) whenever the block runs dry.
+template <typename Refill>
+static void
+bench_work(benchmark::State &state, gr::sync_block &blk, Refill refill) {
+    const int noutput_items = state.range(0);
+    std::vector<unsigned char> outbuf(noutput_items);
+    gr_vector_const_void_star input_items;
+    gr_vector_void_star output_items(1, &outbuf[0]);
+    long items = 0;
+    for(auto _ : state) {
+        int ret = blk.work(noutput_items, input_items, output_items);
+        if(ret <= 0) {
+            state.PauseTiming();
+            refill();
+            state.ResumeTiming();
+            continue;
+        }
+        items += ret;
+    }
+    state.SetItemsProcessed(items);
+}
+
+static void
+BM_pocencode_work(benchmark::State &state) {
+    // Persistent, so pages are sent to the same block as it runs dry.
+    pocencode_impl blk(pocencode::Alpha, 1200, 1234567, alpha_msg, 38400, true);
+    const pmt::pmt_t pdu = pmt::cons(pmt::make_dict(), pmt::init_u8vector(alpha_msg.length(), (const uint8_t *)alpha_msg.c_str()));
+    bench_work(state, blk, [&]() { blk.page_message(pdu); });
+}
+BENCHMARK(BM_pocencode_work)->Arg(64)->Arg(1024)->Arg(8192)->Arg(65536);
+
+static void
+BM_gscencode_work(benchmark::State &state) {
+    gscencode_impl blk(gscencode::Alpha, 123456, alpha_msg, 38400, true);
+    const pmt::pmt_t pdu = pmt::cons(pmt::make_dict(), pmt::init_u8vector(alpha_msg.length(), (const uint8_t *)alpha_msg.c_str()));
+    bench_work(state, blk, [&]() { blk.page_message(pdu); });
+}
+BENCHMARK(BM_gscencode_work)->Arg(64)->Arg(1024)->Arg(8192)->Arg(65536);
+
+static void
+BM_flexencode_work(benchmark::State &state) {
+    // A single-entry channel map, so the block never needs to tag a retune
+    // (which would require a running flowgraph).
+    flexencode_impl blk(0, 0, 0, std::vector<double>(1, 931337500), 0, 0, "", 0, "", 0, 0, 0, false);
+    const std::string cmd = "flex 0 931337500 alpha 1337000 4841434b2054484520504c414e4554";
+    const pmt::pmt_t pdu = pmt::cons(pmt::make_dict(), pmt::init_u8vector(cmd.length(), (const uint8_t *)cmd.c_str()));
+    auto refill = [&]() {
+        blk.beeps_message(pdu);
+    };
+    refill();
+    bench_work(state, blk, refill);
+}
+BENCHMARK(BM_flexencode_work)->Arg(64)->Arg(1024)->Arg(8192)->Arg(65536);
+
+static void
+BM_fskmod_work(benchmark::State &state) {
+    const int shaping = state.range(1);
+    fskmod_impl blk(998400, 26, 4800, shaping, 0.5, 1600, 1.0);
+    const int noutput_items = state.range(0) * 26;
+    // Room for the block's history in front of the input.
+    std::vector<int8_t> inbuf(state.range(0) + 1024);
+    for(size_t i = 0; i < inbuf.size(); i++) {
+        inbuf[i] = ((i / 24) & 1) ? 1 : -1;
+    }
+    std::vector<gr_complex> outbuf(noutput_items);
+    gr_vector_const_void_star input_items(1, &inbuf[0]);
+    gr_vector_void_star output_items(1, &outbuf[0]);
+    for(auto _ : state) {
+        blk.work(noutput_items, input_items, output_items);
+        benchmark::DoNotOptimize(outbuf.data());
+    }
+    state.SetItemsProcessed(state.iterations() * noutput_items);
+}
+BENCHMARK(BM_fskmod_work)->Args({64, 0})->Args({1024, 0})->Args({8192, 0})->Args({1024, 1})->Args({1024, 2});
+
+static void
+BM_fsksynth_work(benchmark::State &state) {
+    const int nchans = state.range(1);
+    std::vector<double> offsets;
+    for(int i = 0; i < nchans; i++) {
+        offsets.push_back(-400000.0 + i * 25000.0);
+    }
+    fsksynth_impl blk(998400, 26, offsets, 4800);
+    const int noutput_items = state.range(0) * 26;
+    std::vector<int8_t> inbuf(state.range(0));
+    for(size_t i = 0; i < inbuf.size(); i++) {
+        inbuf[i] = ((i / 24) & 1) ? 1 : -1;
+    }
+    std::vector<gr_complex> outbuf(noutput_items);
+    gr_vector_const_void_star input_items(nchans, &inbuf[0]);
+    gr_vector_void_star output_items(1, &outbuf[0]);
+    for(auto _ : state) {
+        blk.work(noutput_items, input_items, output_items);
+        benchmark::DoNotOptimize(outbuf.data());
+    }
+    state.SetItemsProcessed(state.iterations() * noutput_items);
+}
+BENCHMARK(BM_fsksynth_work)->Args({1024, 1})->Args({1024, 4})->Args({1024, 16})->Args({8192, 16});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,553 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+// The page encoders behind the encoder blocks (see core.h).  Everything here
+// works on the page and output passed in, so it's safe to call from any
+// number of threads.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gnuradio/mixalot/core.h>
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include "flex_words.h"
+#include "golay.h"
+#include "gsc_tables.h"
+#include "tx_builder.h"
+#include "utils.h"
+
+using std::string;
+using std::vector;
+
+namespace gr {
+    namespace mixalot {
+        namespace core {
+
+            /*
+             * FLEX: one frame (cycle 0, frame 0) with a short-address page to
+             * each capcode, all sharing the one message.
+             */
+            static bool
+            encode_flex(const page &pg, tx_builder<flex_traits> &w, string &error) {
+                const uint32_t bs = 0xAAAA;             // 16 bits
+                const uint32_t a1 = 0x78F35939;
+                const uint32_t ar = 0xCB205939;
+                const uint32_t b = 0x5555;              // 16 bits
+                const uint32_t cblock_hi = 0xAE;        // 40 bits
+                const uint32_t cblock_lo = 0xD845127B;
+                const uint32_t idle_word = 0;
+                const uint32_t idle_word2 = 0x1FFFFF;
+
+                if(pg.capcodes.empty()) {
+                    error = "no capcodes";
+                    return false;
+                }
+                vector<uint32_t> addrwords;
+                for(auto it = pg.capcodes.begin(); it != pg.capcodes.end(); it++) {
+                    uint32_t addr = make_short_address(*it + 32768);
+                    if(addr == 0) {    // 0 is not a valid codeword for what we're doing here, so we use it as an error
+                        error = "couldn't get address for capcode " + std::to_string(*it);
+                        return false;
+                    }
+                    addrwords.push_back(addr);
+                }
+
+                vector<uint32_t> allwords;
+                allwords.push_back(make_biw1(0, 0, 1+addrwords.size(), 0, 0));
+                allwords.insert(allwords.end(), addrwords.begin(), addrwords.end());
+
+                vector<uint32_t> vecwords;
+                vector<uint32_t> msgwords;
+                uint32_t new_msg_checksum;
+                if(pg.type == Alpha) {
+                    if(!make_alphanumeric_msg(1, allwords.size()+1, pg.message, vecwords, msgwords, error)) {
+                        return false;
+                    }
+                } else if(pg.type == Numeric) {
+                    if(!make_standard_numeric_msg(1, allwords.size()+1, pg.message, vecwords, msgwords, new_msg_checksum, error)) {
+                        return false;
+                    }
+                } else {
+                    error = "invalid msgtype " + std::to_string((int)pg.type);
+                    return false;
+                }
+                allwords.insert(allwords.end(), vecwords.begin(), vecwords.end());
+                allwords.insert(allwords.end(), msgwords.begin(), msgwords.end());
+                if(allwords.size() > 88) {
+                    error = "page doesn't fit in a frame";
+                    return false;
+                }
+                while(allwords.size() < 88) {
+                    if((allwords.size() % 2) == 0) {
+                        allwords.push_back(idle_word);
+                    } else {
+                        allwords.push_back(idle_word2);
+                    }
+                }
+
+                for(unsigned int i = 0; i < 35; i++) {
+                    w.bits(bs, 16);
+                    w.bits(ar, 32);
+                    w.bits(~bs, 16);
+                    w.bits(~ar, 32);
+                }
+                w.alternating(32, true);    // bit sync 1
+                w.bits(a1, 32);
+                w.bits(b, 16);
+                w.bits(~a1, 32);
+                w.word(make_fiw(0, 0, 0, 0, 0x0));
+                w.bits(cblock_hi, 8);
+                w.bits(cblock_lo, 32);
+
+                for(unsigned int block = 0; block < 11; block++) {
+                    w.interleaved(&allwords[block * 8]);
+                }
+                return true;
+            }
+
+#define POCSAG_SYNCWORD 0x7CD215D8
+#define POCSAG_IDLEWORD 0x7A89C197
+
+            /*
+             * POCSAG: preamble, then batches of a sync word and 16 code words
+             * (8 frames of 2).  Each capcode's address word goes in its frame,
+             * followed by the message words and an idle word.  A page to
+             * several capcodes is one burst: the message is encoded once,
+             * and the addresses share the preamble and the batches, each one
+             * placed in the next slot of its frame, taking whichever capcode
+             * can go soonest.
+             */
+            template<class Traits>
+            static bool
+            encode_pocsag(const page &pg, tx_builder<Traits> &w, string &error) {
+                if(pg.capcodes.empty()) {
+                    error = "no capcode";
+                    return false;
+                }
+                std::vector<uint32_t> msgwords;
+                uint32_t functionbits = 0;
+                try {
+                    switch(pg.type) {
+                        case Numeric:
+                            make_numeric_message(pg.message, msgwords);
+                            functionbits = 0;
+                            break;
+                        case Alpha:
+                            make_alpha_message(pg.message, msgwords);
+                            functionbits = 3;
+                            break;
+                        default:
+                            error = "invalid msgtype " + std::to_string((int)pg.type);
+                            return false;
+                    }
+                } catch(std::exception &exc) {
+                    error = exc.what();
+                    return false;
+                }
+                msgwords.push_back(POCSAG_IDLEWORD);
+
+                std::vector<uint32_t> remaining;
+                for(uint32_t capcode : pg.capcodes) {
+                    if(capcode > 0x1FFFFF) {
+                        error = "capcode out of range: " + std::to_string(capcode);
+                        return false;
+                    }
+                    remaining.push_back(capcode);
+                }
+                // A capcode listed twice still gets the page once.
+                std::sort(remaining.begin(), remaining.end());
+                remaining.erase(std::unique(remaining.begin(), remaining.end()), remaining.end());
+
+                w.alternating(576, true);
+                unsigned int slot = 0;              // code words sent since the last sync word
+                auto put = [&](uint32_t word) {
+                    if(slot == 0) {
+                        w.word(POCSAG_SYNCWORD);
+                    }
+                    w.word(word);
+                    slot = (slot + 1) % 16;
+                };
+                while(!remaining.empty()) {
+                    // Idle words until the slot of the capcode that's reached soonest.
+                    size_t next = 0;
+                    unsigned int wait = 16;
+                    for(size_t i = 0; i < remaining.size(); i++) {
+                        const unsigned int frame = 2 * (remaining[i] & 7);
+                        const unsigned int n = slot <= frame ? frame - slot
+                            : slot == frame + 1 ? 0
+                            : 16 - slot + frame;
+                        if(n < wait) {
+                            wait = n;
+                            next = i;
+                        }
+                    }
+                    for(unsigned int i = 0; i < wait; i++) {
+                        put(POCSAG_IDLEWORD);
+                    }
+                    const uint32_t capcode = remaining[next];
+                    remaining.erase(remaining.begin() + next);
+
+                    const uint32_t addrtemp = (capcode >> 3) << 13 | ((functionbits & 3) << 11);
+                    const uint32_t addrword = encodeword(addrtemp);
+                    assert((addrword & 0xFFFFF800) == addrtemp);
+                    put(addrword);
+                    for(uint32_t word : msgwords) {
+                        put(word);
+                    }
+                }
+                while(slot != 0) {
+                    put(POCSAG_IDLEWORD);
+                }
+                return true;
+            }
+
+            /*
+             * GSC
+             */
+
+            // A Golay (23,12) word the way GSC sends it: the 12 data bits,
+            // then the 11 check bits, each LSB first.  Bit i is the i-th bit
+            // sent.
+            static uint32_t
+            gsc_golay_word(uint32_t data) {
+                const uint32_t golay = calcgolay(data);
+                return (data & 0xfff) | ((golay & 0x7ff) << 12);
+            }
+
+            // A Golay word at half rate: every bit is sent twice.
+            static inline void
+            gsc_dup(tx_builder<gsc_traits> &w, uint32_t word, bool invert) {
+                w.word<2>(invert ? ~word : word);
+            }
+
+            static bool
+            gsc_pagerid(const unsigned int code, unsigned int &word1, unsigned int &word2, unsigned int &preamble_idx, string &error) {
+                unsigned int c = code;
+                if(c > 999999) {
+                    error = "invalid code -- too large!";
+                    return false;
+                }
+                unsigned int i = (c / 100000);
+                c -= (i * 100000);
+                unsigned int g1 = (c / 10000);
+                c -= (g1 * 10000);
+                unsigned int g0 = (c / 1000);
+                c -= (g0 * 1000);
+                unsigned int a2 = (c / 100);
+                c -= (a2 * 100);
+                unsigned int a1 = (c / 10);
+                c -= (a1 * 10);
+                unsigned int a0 = c;
+
+                preamble_idx = (i + g0) % 10;
+                unsigned int ap = (code % 1000) * 2;
+                const unsigned int ap3 = ap / 1000;
+                ap -= (ap3 * 1000);
+                const unsigned int ap2 = ap / 100;
+                ap -= (ap2 * 100);
+                const unsigned int ap1 = ap / 10;
+                ap -= (ap1 * 10);
+                const unsigned int ap0 = ap;
+
+                const unsigned int b1b0 = (ap1 * 10 + ap0) / 2;
+                const unsigned int b3b2 = (ap3 * 10 + ap2);
+                const unsigned int g1g0 = (g1 * 10 + g0);
+                if(g1g0 >= 50) {
+                    word1 = g1g0 - 50;
+                    word2 = (b3b2 * 100 + b1b0) + 50;
+                } else {
+                    word1 = g1g0;
+                    word2 = (b3b2 * 100 + b1b0);
+                }
+                const unsigned int a2a1a0 = (a2 * 100 + a1 * 10 + a0);
+                const unsigned int illegal_low[16] = { 000, 025, 051, 103, 206, 340, 363, 412, 445, 530, 642, 726, 782, 810, 825, 877 };
+                const unsigned int illegal_high[7] = { 000, 292, 425, 584, 631, 841, 851 };
+                if(g1g0 < 50) {
+                    for(unsigned int n = 0; n < 16; n++) {
+                        if(a2a1a0 == illegal_low[n]) {
+                            error = "invalid value for a2a1a0";
+                            return false;
+                        }
+                    }
+                } else {
+                    for(unsigned int n = 0; n < 7; n++) {
+                        if(a2a1a0 == illegal_high[n]) {
+                            error = "invalid value for a2a1a0";
+                            return false;
+                        }
+                    }
+                }
+                return true;
+            }
+
+            // Eight characters (and the continue bit) as a data block: 8
+            // BCH(15,7) words, sent interleaved after a comma bit.
+            static void
+            gsc_data_block(tx_builder<gsc_traits> &w, const unsigned char *blockmsg, bool continuebit) {
+                unsigned long infowords[8] = {
+                    ((unsigned long)blockmsg[0] | ((unsigned long)blockmsg[1] << 6)) & 0x7f,
+                    (((unsigned long)blockmsg[1] >> 1) | ((unsigned long)blockmsg[2] << 5)) & 0x7f,
+                    (((unsigned long)blockmsg[2] >> 2) | ((unsigned long)blockmsg[3] << 4)) & 0x7f,
+                    (((unsigned long)blockmsg[3] >> 3) | ((unsigned long)blockmsg[4] << 3)) & 0x7f,
+                    (((unsigned long)blockmsg[4] >> 4) | ((unsigned long)blockmsg[5] << 2)) & 0x7f,
+                    (((unsigned long)blockmsg[5] >> 5) | ((unsigned long)blockmsg[6] << 1)) & 0x7f,
+                    ((unsigned long)blockmsg[7] | ((unsigned long)continuebit << 6)) & 0x7f,
+                    0,
+                };
+                unsigned long checkval = 0;
+                for(unsigned int i = 0; i < 7; i++) {
+                    checkval += infowords[i];
+                }
+                infowords[7] = (checkval & 0x7f);
+                uint32_t codewords[8];
+                for(unsigned int i = 0; i < 8; i++) {
+                    codewords[i] = encode_bch15_7(infowords[i]);
+                }
+
+                w.bit((codewords[0] & 1) == 0);       // comma bit
+                w.interleaved<15>(codewords);
+            }
+
+            // Translate the message to GSC characters, padded to whole blocks.
+            static bool
+            gsc_message_chars(msgtype_t type, const string &message, vector<unsigned char> &chars, string &error) {
+                size_t finallen = message.length();
+                if((finallen % 8) != 0) {
+                    finallen += (8-(finallen % 8));
+                }
+                if(type == Alpha) {
+                    chars.assign(finallen, 0x3e);
+
+                    // Based off of Table VII, Rep. 900-2, Annex I
+                    for(size_t i = 0; i < message.length(); i++) {
+                        unsigned char c = (unsigned char)toupper(message[i]);
+                        if(c == 0x0a || c == 0x0d) {
+                            c = 0x3c;
+                        } else if(c == 0x7b) {
+                            c = 0x3b;
+                        } else if(c == 0x7e) {
+                            c = 0x3d;
+                        } else if(c == 0x5c) {
+                            c = 0x20;
+                        } else if(c < 0x20 || c > 0x5d) {
+                            c = 0x20;
+                        } else {
+                            c = c - 0x20;
+                        }
+                        chars[i] = c;
+                    }
+                } else if(type == Numeric) {
+                    chars.assign(finallen, 0xa);
+                    for(size_t i = 0; i < message.length(); i++) {
+                        unsigned char v = 0;
+                        switch(message[i]) {
+                            case '0': v = 0; break;
+                            case '1': v = 1; break;
+                            case '2': v = 2; break;
+                            case '3': v = 3; break;
+                            case '4': v = 4; break;
+                            case '5': v = 5; break;
+                            case '6': v = 6; break;
+                            case '7': v = 7; break;
+                            case '8': v = 8; break;
+                            case '9': v = 9; break;
+                            case 'U': v = 11; break;
+                            case ' ': v = 12; break;
+                            case '-': v = 13; break;
+                            case '=': v = 14; break;
+                            case 'E': v = 15; break;
+                            default:
+                                error = "non-digit character included in numeric message";
+                                return false;
+                        }
+                        chars[i] = v;
+                    }
+                } else {
+                    error = "invalid msgtype " + std::to_string((int)type);
+                    return false;
+                }
+                return true;
+            }
+
+            static bool
+            encode_gsc(const page &pg, tx_builder<gsc_traits> &w, string &error) {
+                if(pg.capcodes.empty()) {
+                    error = "no capcode";
+                    return false;
+                }
+                unsigned int word1, word2, preamble;
+                vector<unsigned char> chars;
+                if(!gsc_pagerid(pg.capcodes[0], word1, word2, preamble, error)
+                        || !gsc_message_chars(pg.type, pg.message, chars, error)) {
+                    return false;
+                }
+
+                // Preamble: one of ten words, picked by the capcode.
+                const uint32_t pdata = preamble_values[preamble];
+                w.alternating(28, (pdata & 1));
+                for(int i = 0; i < 18; i++) {
+                    gsc_dup(w, gsc_golay_word(pdata), false);
+                }
+
+                // Start code, then its inverse.  The comma and the bit between
+                // them are fixed because (713 & 1) == 1.
+                const uint32_t start = gsc_golay_word(gsc_startcode);
+                w.alternating(28, true);
+                gsc_dup(w, start, false);
+                w.bit(1);
+                gsc_dup(w, start, true);
+
+                // Address.
+                bool compword1 = false;
+                assert(word1 < 100);
+                if(word1 > 49) {
+                    word1 -= 50;
+                    compword1 = true;
+                }
+                compword1 = !compword1;
+                const uint32_t addr1 = gsc_golay_word(word1s[word1]);
+                const uint32_t addr2 = gsc_golay_word(word2);
+                w.alternating(28, (addr1 & 1) != compword1);
+                gsc_dup(w, addr1, compword1);
+                w.bit((addr2 & 1) == 0);
+                gsc_dup(w, addr2, false);
+
+                // Message.
+                for(size_t i = 0; i < chars.size(); i += 8) {
+                    gsc_data_block(w, &chars[i], (i + 8) != chars.size());
+                }
+                w.alternating(121 * 8, true);
+                return true;
+            }
+
+            // Run one protocol's encoder with its builder.
+            template<class Traits>
+            static bool
+            build(const page &pg, encoded_page &out, string &error, bool (*encoder)(const page &, tx_builder<Traits> &, string &)) {
+                tx_builder<Traits> w(out);
+                const bool ok = encoder(pg, w, error);
+                w.finish();
+                return ok;
+            }
+
+            static bool
+            encode_type(const page &pg, encoded_page &out, string &err) {
+                bool ok;
+                switch(pg.protocol) {
+                    case FLEX:
+                        ok = build<flex_traits>(pg, out, err, encode_flex);
+                        break;
+                    case POCSAG512:
+                        ok = build<pocsag_traits<512>>(pg, out, err, encode_pocsag<pocsag_traits<512>>);
+                        break;
+                    case POCSAG1200:
+                        ok = build<pocsag_traits<1200>>(pg, out, err, encode_pocsag<pocsag_traits<1200>>);
+                        break;
+                    case POCSAG2400:
+                        ok = build<pocsag_traits<2400>>(pg, out, err, encode_pocsag<pocsag_traits<2400>>);
+                        break;
+                    case GSC:
+                        ok = build<gsc_traits>(pg, out, err, encode_gsc);
+                        break;
+                    default:
+                        err = "invalid protocol";
+                        ok = false;
+                        break;
+                }
+                out.type = pg.type;
+                return ok;
+            }
+
+            /*
+             * Auto: encode it both ways and keep whichever has fewer code
+             * words.  Alpha wins a tie, since every display pager can show it.
+             * The numeric encoding fails early on a message with anything
+             * but numeric characters (each protocol has its own set).
+             */
+            static bool
+            encode_auto(const page &pg, encoded_page &out, string &err) {
+                page typed(pg);
+                typed.type = Alpha;
+                encoded_page alpha;
+                string alpha_err;
+                const bool alpha_ok = encode_type(typed, alpha, alpha_err);
+
+                typed.type = Numeric;
+                string numeric_err;
+                if(encode_type(typed, out, numeric_err)
+                        && (!alpha_ok || out.codewords < alpha.codewords)) {
+                    if(alpha_ok) {
+                        out.auto_saved = alpha.seconds() - out.seconds();
+                    }
+                    return true;
+                }
+                out = std::move(alpha);
+                err = alpha_err;
+                return alpha_ok;
+            }
+
+            bool
+            encode(const page &pg, encoded_page &out, string *error) {
+                out = encoded_page();
+                string err;
+                const bool ok = pg.type == Auto ? encode_auto(pg, out, err) : encode_type(pg, out, err);
+                if(!ok) {
+                    out = encoded_page();
+                    if(error) {
+                        *error = err;
+                    }
+                }
+                return ok;
+            }
+
+            bool
+            parse_protocol(const string &name, protocol_t &protocol) {
+                if(name == "flex") {
+                    protocol = FLEX;
+                } else if(name == "pocsag512") {
+                    protocol = POCSAG512;
+                } else if(name == "pocsag1200") {
+                    protocol = POCSAG1200;
+                } else if(name == "pocsag2400") {
+                    protocol = POCSAG2400;
+                } else if(name == "gsc") {
+                    protocol = GSC;
+                } else {
+                    return false;
+                }
+                return true;
+            }
+
+            const char *
+            protocol_name(protocol_t protocol) {
+                switch(protocol) {
+                    case FLEX:       return "flex";
+                    case POCSAG512:  return "pocsag512";
+                    case POCSAG1200: return "pocsag1200";
+                    case POCSAG2400: return "pocsag2400";
+                    case GSC:        return "gsc";
+                }
+                return "";
+            }
+
+            unsigned int
+            protocol_baudrate(protocol_t protocol) {
+                switch(protocol) {
+                    case FLEX:       return 1600;
+                    case POCSAG512:  return 512;
+                    case POCSAG1200: return 1200;
+                    case POCSAG2400: return 2400;
+                    case GSC:        return 600;
+                }
+                return 0;
+            }
+
+        } /* namespace core */
+    } /* namespace mixalot */
+} /* namespace gr */
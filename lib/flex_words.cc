@@ -0,0 +1,359 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "flex_words.h"
+#include <cassert>
+#include "utils.h"
+
+using std::string;
+using std::vector;
+
+namespace gr {
+    namespace mixalot {
+
+        /**
+         * Add a 4-bit ("x"-style) checksum to the lower 4 bits of dw.
+         * See section 3.8.1 in the flex spec.
+         */
+        void
+        add_flex_checksum(uint32_t &dw) {
+            uint32_t cksum = 
+                ((dw >> 4) & 0xf)
+                + ((dw >> 8) & 0xf)
+                + ((dw >> 12) & 0xf)
+                + ((dw >> 16) & 0xf)
+                + ((dw >> 20) & 1);
+            cksum = ~cksum;
+            dw |= (cksum & 0xf);
+        }
+
+
+        /**
+         * Make an encoded FIW with the given parameters.
+         *
+         * The resulting 32-bit word includes checksum and parity, and is reversed. So, the
+         * MSB of the return value here is actually bit 1 (LSB of x, aka x0 in section
+         * 3.8.3), and the LSB of the return value here is the parity bit.
+         */
+        uint32_t
+        make_fiw(uint32_t cycle, uint32_t frame, uint32_t roaming, uint32_t repeat, uint32_t t) {
+            uint32_t dw = 0;
+            dw |= (cycle & 0xf) << 4;
+            dw |= (frame & 0x7f) << 8;
+            dw |= (roaming & 1) << 15;
+            dw |= (repeat & 1) << 16;
+            dw |= (t & 0xf) << 17;
+            
+            add_flex_checksum(dw);
+
+            uint32_t encoded = encodeword(reverse_bits32(dw));
+
+            return encoded;
+        }
+
+        /**
+         * Make an encoded BIW 1 with the given parameters.
+         *
+         * Returns a reversed 32-bit word (LSB of ret val is the parity bit).
+         *
+         * NOTE: The second parameter (blockinfo) is the actual value of a, not the number
+         * of words (which is a+1)
+         */
+        uint32_t
+        make_biw1(uint32_t priority, uint32_t blockinfo, uint32_t vectorstart, uint32_t carryon, uint32_t collapse) {
+            uint32_t dw = 0;
+            dw |= (priority & 0xf) << 4;
+            dw |= (blockinfo & 0x3) << 8;
+            dw |= (vectorstart & 0x3f) << 10;
+            dw |= (carryon & 0x3) << 16;
+            dw |= (collapse & 0x7) << 18;
+
+            add_flex_checksum(dw);
+            return encodeword(reverse_bits32(dw));
+        }
+        /**
+         * Make an encoded BIW 001 with the given parameters.
+         * 
+         * Returns a reversed 32-bit word (LSB of ret val is the parity bit).
+         */
+        uint32_t
+        make_biwymd(uint32_t year, uint32_t month, uint32_t day) {
+            uint32_t dw = 0;
+            const uint32_t f = 1;
+            dw |= (f & 0x7) << 4;
+            dw |= (year & 0x1f) << 7;
+            dw |= (day & 0x1f) << 12;
+            dw |= (year & 0xf) << 17;
+            add_flex_checksum(dw);
+            uint32_t encoded = encodeword(reverse_bits32(dw));
+            return encoded;
+        }
+
+        /**
+         * Make an encoded BIW 001 with the given parameters.
+         * 
+         * Returns a reversed 32-bit word (LSB of ret val is the parity bit).
+         */
+        uint32_t 
+        make_biwhms(uint32_t hour, uint32_t minute, uint32_t second) {
+            uint32_t dw = 0;
+            const uint32_t f = 2;
+            dw |= (f & 0x7) << 4;
+            dw |= (hour & 0x1f) << 7;
+            dw |= (minute & 0x3f) << 12;
+            dw |= (second & 0x7) << 18;
+            add_flex_checksum(dw);
+            uint32_t encoded = encodeword(reverse_bits32(dw));
+            return encoded;
+        }
+
+        /**
+         * Make a short-address word.
+         *
+         * Returns a reversed 32-bit word (LSB of ret val is the parity bit), or 0 if
+         * error.
+         */
+        uint32_t
+        make_short_address(uint32_t address) {
+            if(address >= 32769 && address <= 1966080) {
+                uint32_t dw = 0;
+                dw |= (address & 0x1FFFFF);
+                uint32_t encoded = encodeword(reverse_bits32(dw));
+                return encoded;
+            } else {
+                return 0;
+            }
+        }
+
+        /**
+         * Make a numeric vector word.
+         *
+         * NOTE: nwords is not the total number of words in the message; it's the value
+         * to be written into the word (the total number is nwords+1)
+         *
+         * Returns a reversed 32-bit word (LSB of ret val is the parity bit).
+         */
+        uint32_t
+        make_numeric_vector(uint32_t vector_type, uint32_t message_start, uint32_t nwords, uint32_t cksum) {
+            uint32_t dw = 0;
+            dw |= (vector_type & 0x7) << 4;
+            dw |= (message_start & 0x7f) << 7;
+            dw |= (nwords & 0x7) << 14;
+            dw |= (cksum & 0xf) << 17;
+            add_flex_checksum(dw);
+            uint32_t encoded = encodeword(reverse_bits32(dw));
+            return encoded;
+        }
+
+        /**
+         * Make an alphanumeric vector word.
+         *
+         * NOTE: Unlike with numeric vector words, the nwords parameter is actually the
+         * total number of message words.
+         *
+         * Returns a reversed 32-bit word (LSB of ret val is the parity bit).
+         */
+        uint32_t
+        make_alphanumeric_vector(uint32_t message_start, uint32_t nwords) {
+            uint32_t dw = 0;
+            dw |= (0x5) << 4;
+            dw |= (message_start & 0x7f) << 7;
+            dw |= (nwords & 0x7f) << 14;
+            add_flex_checksum(dw);
+            uint32_t encoded = encodeword(reverse_bits32(dw));
+            return encoded;
+        }
+
+        void
+        interleave(uint32_t *words, uint8_t *interleaved) {
+            unsigned int il = 0;
+            for(unsigned int i = 0; i < 32; i++) {
+                for(unsigned int j = 0; j < 8; j++) {
+                    interleaved[il++] = ((words[j] & 0x80000000) == 0x80000000) ? 1 : 0;
+                    words[j] = words[j] << 1;
+                }
+            }
+            assert(il == 256);
+        }
+
+        namespace {
+            const uint8_t FLEX_NUMERIC_INVALID = 0x10;
+
+            // Standard numeric character codes (3.8.8.1), or
+            // FLEX_NUMERIC_INVALID.
+            struct flex_numeric_codes {
+                uint8_t code[256];
+
+                flex_numeric_codes() {
+                    for(int c = 0; c < 256; c++) {
+                        code[c] = FLEX_NUMERIC_INVALID;
+                    }
+                    for(int v = 0; v < 10; v++) {
+                        code['0' + v] = v;
+                    }
+                    code['S'] = code['A'] = 0xa;
+                    code['U'] = code['B'] = 0xb;
+                    code[' '] = 0xc;
+                    code['-'] = code['C'] = 0xd;
+                    code[']'] = code[')'] = code['D'] = 0xe;
+                    code['['] = code['('] = code['E'] = 0xf;
+                }
+            };
+
+            const uint8_t *
+            flex_numeric_table() {
+                static const flex_numeric_codes codes;
+                return codes.code;
+            }
+        }
+
+        bool
+        make_alphanumeric_msg(unsigned int num_address_words, unsigned int message_start, const string &msg, vector<uint32_t> &vecwords, vector<uint32_t> &msgwords, string &error) {
+            assert(num_address_words == 1);     // XXX no long address yet
+            const int len = msg.length();
+            // 85 words (a whole frame, less the BIW, address and vector) of
+            // three slots each, after the checksum word and the signature.
+            if(len < 1 || len > 251) {
+                error = "invalid alphanumeric message len: " + std::to_string(len);
+                return false;
+            }
+            uint32_t msgbuf[85];
+            for(int i = 0; i < 85; i++) {
+                msgbuf[i] = 0;
+            }
+
+            // First, fill in the actual message characters, three to a word,
+            // after the signature in the first slot of word 1.  Then fill
+            // the rest of the last word with ETX.
+            for(int i = 0; i < len; i++) {
+                const unsigned int slot = i + 1;
+                msgbuf[1 + slot / 3] |= (msg[i] & 0x7f) << (7 * (slot % 3));
+            }
+            static const uint32_t etx_fill[3] = { 0, (0x03 << 7) | (0x03 << 14), (0x03 << 14) };
+            const unsigned int endslot = len + 1;
+            uint32_t wordidx = 1 + endslot / 3;
+            if(endslot % 3) {
+                msgbuf[wordidx++] |= etx_fill[endslot % 3];
+            }
+            // Then, calculate the signature (S) over the message.
+            // XXX: should we include 0x03 padding in this calculation?
+            uint32_t sig = 0;
+            for(uint32_t i = 1; i < wordidx; i++) {
+                sig += (msgbuf[i] & 0x7f);
+                sig += ((msgbuf[i] >> 7) & 0x7f);
+                sig += ((msgbuf[i] >> 14) & 0x7f);
+            }
+            sig = ~sig;
+            msgbuf[1] |= (sig & 0x7f);
+
+            msgbuf[0] |= (0x3 << 11);       // F = 0b11, 3.8.8.3
+
+            // Now, we calculate the fragment checksum K.
+            uint32_t binsum = 0;
+            for(uint32_t i = 0; i < wordidx; i++) {
+                uint32_t mw = msgbuf[i];
+                uint32_t wordsum = (mw & 0xff) + ((mw >> 8) & 0xff) + ((mw >> 16) & 0x1f);
+                binsum += wordsum;
+            }
+            uint32_t msg_checksum = (~(binsum) & 0x3ff);
+            msgbuf[0] |= (msg_checksum & 0x3ff);
+
+            uint32_t vecword = make_alphanumeric_vector(message_start, wordidx);
+            vecwords.push_back(vecword);
+            const size_t first = msgwords.size();
+            msgwords.resize(first + wordidx);
+            for(uint32_t i = 0; i < wordidx; i++) {
+                msgwords[first + i] = reverse_bits32(msgbuf[i]);
+            }
+            encodewords(msgwords.data() + first, msgwords.data() + first, wordidx);
+            return true;
+        }
+
+        bool
+        make_standard_numeric_msg(unsigned int num_address_words, unsigned int message_start, const string &msg, vector<uint32_t> &vecwords, vector<uint32_t> &msgwords, uint32_t &checksum, string &error) {
+            assert(num_address_words == 1);     // XXX no long address yet
+            const int len = msg.length();
+            if(len < 1 || len > 41) {
+                error = "invalid numeric message len: " + std::to_string(len);
+                return false;
+            }
+            uint32_t msgbuf[8];
+            for(int i = 0; i < 8; i++) {
+                msgbuf[i] = 0;
+            }
+            // Digits go in 4 bits at a time, LSB first, after the two checksum
+            // bits; a 64-bit accumulator collects them into 21-bit words.
+            const uint8_t *tbl = flex_numeric_table();
+            uint32_t bad = 0;
+            uint64_t acc = 0;               // bits not yet in msgbuf, lowest first
+            unsigned int nacc = 2;
+            uint32_t nwords = 0;
+            for(int i = 0; i < len; i++) {
+                const uint32_t val = tbl[(uint8_t)msg[i]];
+                bad |= val;
+                acc |= (uint64_t)(val & 0xf) << nacc;
+                nacc += 4;
+                if(nacc >= 21) {
+                    msgbuf[nwords++] = acc & 0x1fffff;
+                    acc >>= 21;
+                    nacc -= 21;
+                }
+            }
+            if(bad & FLEX_NUMERIC_INVALID) {
+                for(int i = 0; i < len; i++) {
+                    if(tbl[(uint8_t)msg[i]] & FLEX_NUMERIC_INVALID) {
+                        error = string("invalid character in message: ") + msg[i];
+                        break;
+                    }
+                }
+                return false;
+            }
+
+            // If we ended on a word boundary (e.g. at the 3rd word or the 7th
+            // word -- see 3.8.8.1), then we don't need to do any filling.
+            // Otherwise, fill all remaining 4-char blocks with 0xc and all
+            // remaining spaces with zeroes.
+            if(nacc > 0) {
+                for(; nacc + 4 <= 21; nacc += 4) {
+                    acc |= (uint64_t)0xc << nacc;
+                }
+                msgbuf[nwords++] = acc & 0x1fffff;
+            }
+            assert(message_start+nwords <= 88);
+
+            // Now, calculate the checksum according to 3.8.8.1.
+            uint32_t binsum = 0;
+            for(uint32_t i = 0; i < nwords; i++) {
+                uint32_t mw = msgbuf[i];
+                uint32_t wordsum = (mw & 0xff) + ((mw >> 8) & 0xff) + ((mw >> 16) & 0x1f);
+                binsum += wordsum;
+            }
+            binsum &= 0xff;
+            uint32_t tempsum = (binsum & 0x3f) + ((binsum >> 6) & 0x3);
+            uint32_t msg_checksum = (~(tempsum) & 0x3f);
+
+            // Now that we've calculated the checksum, we can fill in the first two bits
+            // (which are the two most-significant bits in the checksum value)
+            msgbuf[0] |= ((msg_checksum >> 4) & 0x3);
+
+            uint32_t vecword = make_numeric_vector(3, message_start, nwords-1, (msg_checksum & 0xf));
+
+            checksum = msg_checksum;
+            vecwords.push_back(vecword);
+            const size_t first = msgwords.size();
+            msgwords.resize(first + nwords);
+            for(uint32_t i = 0; i < nwords; i++) {
+                msgwords[first + i] = reverse_bits32(msgbuf[i]);
+            }
+            encodewords(msgwords.data() + first, msgwords.data() + first, nwords);
+            return true;
+        }
+    } /* namespace mixalot */
+} /* namespace gr */
@@ -0,0 +1,42 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_FLEX_WORDS_H
+#define INCLUDED_MIXALOT_FLEX_WORDS_H
+
+// FLEX code word builders.  Unless noted, each returns an encoded word,
+// bit-reversed: the MSB is the first bit sent and the LSB is the parity bit.
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace gr {
+    namespace mixalot {
+
+        void add_flex_checksum(uint32_t &dw);
+        uint32_t make_fiw(uint32_t cycle, uint32_t frame, uint32_t roaming, uint32_t repeat, uint32_t t);
+        uint32_t make_biw1(uint32_t priority, uint32_t blockinfo, uint32_t vectorstart, uint32_t carryon, uint32_t collapse);
+        uint32_t make_biwymd(uint32_t year, uint32_t month, uint32_t day);
+        uint32_t make_biwhms(uint32_t hour, uint32_t minute, uint32_t second);
+        uint32_t make_short_address(uint32_t address);
+        uint32_t make_numeric_vector(uint32_t vector_type, uint32_t message_start, uint32_t nwords, uint32_t cksum);
+        uint32_t make_alphanumeric_vector(uint32_t message_start, uint32_t nwords);
+
+        // Interleave 8 FLEX codewords into a 256-bit block (one bit per byte).
+        void interleave(uint32_t *words, uint8_t *interleaved);
+
+        // Build the vector and message words for a page.  Return false, with
+        // the reason in error, if msg can't be sent as that type.
+        bool make_alphanumeric_msg(unsigned int num_address_words, unsigned int message_start, const std::string &msg,
+                std::vector<uint32_t> &vecwords, std::vector<uint32_t> &msgwords, std::string &error);
+        bool make_standard_numeric_msg(unsigned int num_address_words, unsigned int message_start, const std::string &msg,
+                std::vector<uint32_t> &vecwords, std::vector<uint32_t> &msgwords, uint32_t &checksum, std::string &error);
+
+    } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_FLEX_WORDS_H */
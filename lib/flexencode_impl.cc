@@ -9,16 +9,23 @@
 #endif
 
 #include <gnuradio/io_signature.h>
+#ifdef GR_CTRLPORT
+#include <gnuradio/rpcregisterhelpers.h>
+#endif
 #include "flexencode_impl.h"
+#include "logging.h"
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/trim.hpp>
+#include <boost/algorithm/string/join.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <sstream>
+#include <gnuradio/mixalot/core.h>
 #include "utils.h"
 
-using namespace itpp;
 using std::string;
 using std::vector;
 using std::shared_ptr;
@@ -27,6 +34,9 @@ using std::shared_ptr;
 namespace gr {
     namespace mixalot {
 
+        // Resolution of "sendat"/"sendin"
+        static const std::chrono::milliseconds SCHED_TICK(10);
+
         // Reverses the bits in a byte and then shifts.  Useful for converting 
         static inline uint8_t 
         convchar(uint8_t b) {
@@ -37,8 +47,8 @@ namespace gr {
         }
 
         flexencode::sptr
-        flexencode::make() {
-            return gnuradio::get_initial_sptr (new flexencode_impl());
+        flexencode::make(double max_queue_seconds, unsigned int max_queue_pages, unsigned long max_queue_bytes, const std::vector<double> &channel_freqs, double stats_interval, unsigned int trace_depth, const std::string &playback_dir, unsigned long cache_bytes, const std::string &journal_path, unsigned int encode_threads, double page_ttl, double dedup_window, bool retune_messages) {
+            return gnuradio::get_initial_sptr (new flexencode_impl(max_queue_seconds, max_queue_pages, max_queue_bytes, channel_freqs, stats_interval, trace_depth, playback_dir, cache_bytes, journal_path, encode_threads, page_ttl, dedup_window, retune_messages));
         }
         std::string
         u32tostring(unsigned int x) {
@@ -55,654 +65,697 @@ namespace gr {
         }
 
         /**
-         * Add a 4-bit ("x"-style) checksum to the lower 4 bits of dw.
-         * See section 3.8.1 in the flex spec.
+         * Key for d_cache: the command normalized to just what determines the
+         * transmitted bits.  The tag and frequency are left out (a resend
+         * under a new tag, or on another channel, is the same transmission),
+         * capcodes are in canonical decimal, and the message is decoded, so
+         * differences in hex case or leading zeros don't matter.
          */
+        static string
+        cache_key(const string &protocol, flexencode::msgtype_t msgtype, const vector<uint32_t> &codes, const string &message) {
+            static const char *const typenames[] = { " numeric ", " alpha ", " auto " };
+            std::ostringstream ss;
+            ss << protocol << typenames[msgtype];
+            for(size_t i = 0; i < codes.size(); i++) {
+                ss << (i ? "," : "") << codes[i];
+            }
+            ss << ' ' << message;
+            return ss.str();
+        }
+
+        // A command's capcodes: one, or a comma-separated list.
+        static bool
+        parse_capcodes(const string &capcodestr, vector<uint32_t> &codes) {
+            vector<string> capcodes;
+            boost::split(capcodes, capcodestr, boost::is_any_of(","), boost::token_compress_on);
+            for(const auto &capcode : capcodes) {
+                if(capcode.empty()) {
+                    continue;
+                }
+                errno = 0;
+                const unsigned long code = strtoul(capcode.c_str(), 0, 10);
+                if(code > UINT32_MAX || ((code == ULONG_MAX || code == 0) && errno != 0)) {
+                    return false;
+                }
+                codes.push_back(code);
+            }
+            return !codes.empty();
+        }
+
+        // A command's message type: "alpha", "numeric" or "auto".
+        static bool
+        parse_msgtype(const string &name, flexencode::msgtype_t &msgtype) {
+            if(name == "alpha") {
+                msgtype = flexencode::Alpha;
+            } else if(name == "numeric") {
+                msgtype = flexencode::Numeric;
+            } else if(name == "auto") {
+                msgtype = flexencode::Auto;
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        flexencode_impl::flexencode_impl(double max_queue_seconds, unsigned int max_queue_pages, unsigned long max_queue_bytes, const std::vector<double> &channel_freqs, double stats_interval, unsigned int trace_depth, const std::string &playback_dir, unsigned long cache_bytes, const std::string &journal_path, unsigned int encode_threads, double page_ttl, double dedup_window, bool retune_messages)
+          : sync_block("flexencode",
+                  io_signature::make(0, 0, 0),
+                  io_signature::make(std::max<int>(1, channel_freqs.size()), std::max<int>(1, channel_freqs.size()), sizeof (unsigned char))),
+          d_channel_freqs(channel_freqs), d_cache(cache_bytes), d_playback_dir(playback_dir), d_replay_id(0), d_next_seq(0),
+          d_symrate(38400),
+          d_max_queue_seconds(max_queue_seconds), d_max_queue_pages(max_queue_pages), d_max_queue_bytes(max_queue_bytes),
+          d_trace(trace_depth), d_stats_interval(stats_interval), d_stats_stop(false),
+          d_encode_threads(encode_threads), d_workers_running(false), d_workers_stop(false),
+          d_next_job(0), d_jobs_inflight(0),
+          d_clock(std::chrono::steady_clock::now), d_sched_epoch(d_clock()), d_sched_stop(false),
+          d_page_ttl(page_ttl), d_dedup_window(dedup_window), d_recent(dedup_window), d_retune_messages(retune_messages)
+        {
+            if(d_symrate % 1600 != 0) {
+                d_logger->error("Output symbol rate must be evenly divisible by baud rate!");
+                throw std::runtime_error("Output symbol rate is not evenly divisible by baud rate");
+            }
+            d_chans.resize(std::max<size_t>(1, d_channel_freqs.size()));
+            for(size_t i = 0; i < d_chans.size(); i++) {
+                d_chans[i].current_pos = 0;
+                d_chans[i].current_seq = 0;
+                d_chans[i].pending_samples = 0;
+                d_chans[i].pending_bytes = 0;
+                d_chans[i].group_cutoff = 0;
+                // Channels in the map never retune, so they start out "tuned".
+                d_chans[i].curfreq = d_channel_freqs.empty() ? 0 : d_channel_freqs[i];
+            }
+            //queue_flex_batch(Alpha, vector<uint32_t>(1, 1337331), "started");  // XXX
+            if(!journal_path.empty()) {
+                // Unfinished pages from the last run are queued again in start().
+                d_journal.reset(new page_journal(journal_path));
+            }
+
+            message_port_register_out(pmt::mp("beeps_output"));
+            message_port_register_out(pmt::mp("cmds_out"));
+            message_port_register_out(pmt::mp("stats"));
+            message_port_register_in(pmt::mp("beeps"));
+            /*set_msg_handler(pmt::mp("beeps"),
+                std::bind(&flexencode_impl::beeps_message, this, std::placeholders::_1)
+            );*/
+            set_msg_handler(pmt::mp("beeps"), [this](pmt::pmt_t msg) { this->beeps_message(msg); });
+        }
+        // A job's page has been queued: it stops counting as a job in
+        // flight and starts waiting for its ack, in one step, so that
+        // get_queue_depth() never counts it twice.
         void
-        add_flex_checksum(uint32_t &dw) {
-            uint32_t cksum = 
-                ((dw >> 4) & 0xf)
-                + ((dw >> 8) & 0xf)
-                + ((dw >> 12) & 0xf)
-                + ((dw >> 16) & 0xf)
-                + ((dw >> 20) & 1);
-            cksum = ~cksum;
-            dw |= (cksum & 0xf);
+        flexencode_impl::add_command_id(string cmdid, uint64_t journal_id, uint64_t seq) {
+            boost::mutex::scoped_lock lock(cmdlist_mutex);
+            d_cmdlist.push_back(pending_ack { cmdid, d_clock(), journal_id, seq });
+            d_jobs_inflight--;
+            d_pages_accepted.add();
         }
 
+        // Answer "OK" for a page.  Must be called with cmdlist_mutex held.
+        void
+        flexencode_impl::send_ack(const pending_ack &ack, std::chrono::steady_clock::time_point now) {
+            beeps_output(ack.cmdid + " OK\n");
+            if(d_journal && ack.journal_id != 0) {
+                d_journal->done_later(ack.journal_id);
+            }
+            d_ack_latency_ms.add(std::chrono::duration_cast<std::chrono::milliseconds>(now - ack.accepted).count());
+        }
 
         /**
-         * Make an encoded FIW with the given parameters.
-         *
-         * The resulting 32-bit word includes checksum and parity, and is reversed. So, the
-         * MSB of the return value here is actually bit 1 (LSB of x, aka x0 in section
-         * 3.8.3), and the LSB of the return value here is the parity bit.
+         * Ack a page as soon as it has finished going out, whatever the
+         * other channels are doing.  Acks are kept in arrival order, so the
+         * page is nearly always at or near the front.
          */
-        uint32_t
-        make_fiw(uint32_t cycle, uint32_t frame, uint32_t roaming, uint32_t repeat, uint32_t t) {
-            uint32_t dw = 0;
-            dw |= (cycle & 0xf) << 4;
-            dw |= (frame & 0x7f) << 8;
-            dw |= (roaming & 1) << 15;
-            dw |= (repeat & 1) << 16;
-            dw |= (t & 0xf) << 17;
-            
-            add_flex_checksum(dw);
+        void
+        flexencode_impl::ack_page(uint64_t seq) {
+            boost::mutex::scoped_lock lock(cmdlist_mutex);
+            for(auto it = d_cmdlist.begin(); it != d_cmdlist.end(); it++) {
+                if(it->seq == seq) {
+                    d_trace.record(TRACE_ACK, 0, 1);
+                    send_ack(*it, d_clock());
+                    d_cmdlist.erase(it);
+                    return;
+                }
+            }
+        }
 
-            uint32_t encoded = encodeword(reverse_bits32(dw));
+        void
+        flexencode_impl::reject_command(string const &cmdid, reject_reason reason) {
+            d_rejected[reason].add();
+            d_trace.record(TRACE_REJECT, 0, reason);
+            beeps_output(cmdid + " ERROR\n");
+        }
 
-            return encoded;
+        void
+        flexencode_impl::record_encode_time(std::chrono::steady_clock::time_point start) {
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            const uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+            d_encode_us.add(us);
+            d_trace.record(TRACE_ENCODE, 0, us);
         }
 
         /**
-         * Make an encoded BIW 1 with the given parameters.
-         *
-         * Returns a reversed 32-bit word (LSB of ret val is the parity bit).
-         *
-         * NOTE: The second parameter (blockinfo) is the actual value of a, not the number
-         * of words (which is a+1)
+         * Snapshot the current queue depth.  Pages stay counted until they are
+         * acked, which happens as each one finishes going out.  samples is the
+         * total over all channels; airtime_samples is the longest single
+         * channel, since channels are sent in parallel.  bytes is the memory
+         * held by queued pages (mapped files don't count).
          */
-        uint32_t
-        make_biw1(uint32_t priority, uint32_t blockinfo, uint32_t vectorstart, uint32_t carryon, uint32_t collapse) {
-            uint32_t dw = 0;
-            dw |= (priority & 0xf) << 4;
-            dw |= (blockinfo & 0x3) << 8;
-            dw |= (vectorstart & 0x3f) << 10;
-            dw |= (carryon & 0x3) << 16;
-            dw |= (collapse & 0x7) << 18;
-
-            add_flex_checksum(dw);
-            uint32_t encoded = encodeword(reverse_bits32(dw));
-            std::cout << "XXX BIW1 for encoded: " << std::hex << encoded << std::dec << std::endl;
-            std::cout << "XXX: " << u32tostring(encoded) << std::endl;
-            std::cout << "XXX BIW1 rev encoded: " << std::hex << reverse_bits32(encoded) << std::dec << std::endl;
-            std::cout << "XXX: " << u32tostring(reverse_bits32(encoded)) << std::endl;
-            return encoded;
+        void
+        flexencode_impl::get_queue_depth(unsigned long &pages, unsigned long &samples, unsigned long &airtime_samples, unsigned long &bytes) const {
+            boost::mutex::scoped_lock lock(bitqueue_mutex);
+            samples = 0;
+            airtime_samples = 0;
+            bytes = 0;
+            for(const auto &chan : d_chans) {
+                unsigned long chansamples = chan.pending_samples;
+                bytes += chan.pending_bytes;
+                if(chan.current) {
+                    chansamples += tx_samples(*chan.current) - chan.current_pos;
+                    bytes += chan.current->memory();
+                }
+                samples += chansamples;
+                airtime_samples = std::max(airtime_samples, chansamples);
+            }
+            boost::mutex::scoped_lock cmdlock(cmdlist_mutex);
+            // Pages still being encoded count too, or a burst could get
+            // past the page limit before any of it is queued.
+            pages = d_cmdlist.size() + d_jobs_inflight.load();
         }
-        /**
-         * Make an encoded BIW 001 with the given parameters.
-         * 
-         * Returns a reversed 32-bit word (LSB of ret val is the parity bit).
-         */
-        uint32_t
-        make_biwymd(uint32_t year, uint32_t month, uint32_t day) {
-            uint32_t dw = 0;
-            const uint32_t f = 1;
-            dw |= (f & 0x7) << 4;
-            dw |= (year & 0x1f) << 7;
-            dw |= (day & 0x1f) << 12;
-            dw |= (year & 0xf) << 17;
-            add_flex_checksum(dw);
-            uint32_t encoded = encodeword(reverse_bits32(dw));
-            return encoded;
+
+        void
+        flexencode_impl::report_queue_depth(unsigned long pages, unsigned long airtime_samples, unsigned long bytes) {
+            std::stringstream ss;
+            ss << "QUEUE pages=" << pages
+               << " airtime_ms=" << (airtime_samples * 1000 / d_symrate)
+               << " bytes=" << bytes << "\n";
+            beeps_output(ss.str());
         }
 
         /**
-         * Make an encoded BIW 001 with the given parameters.
-         * 
-         * Returns a reversed 32-bit word (LSB of ret val is the parity bit).
+         * Decide whether a new command may be queued.  If any admission limit
+         * has been reached, answer with "<cmdid> BUSY <retry-after-ms>" followed
+         * by the current queue depth, and return false.
+         *
+         * The retry hint is the time until enough of the queue has been sent
+         * to get back under the limit.  Page slots are released as each page
+         * finishes, so for the page limit the hint assumes the queued pages
+         * are all about the same length.
          */
-        uint32_t 
-        make_biwhms(uint32_t hour, uint32_t minute, uint32_t second) {
-            uint32_t dw = 0;
-            const uint32_t f = 2;
-            dw |= (f & 0x7) << 4;
-            dw |= (hour & 0x1f) << 7;
-            dw |= (minute & 0x3f) << 12;
-            dw |= (second & 0x7) << 18;
-            add_flex_checksum(dw);
-            uint32_t encoded = encodeword(reverse_bits32(dw));
-            return encoded;
+        bool
+        flexencode_impl::admit_command(string const &cmdid) {
+            unsigned long pages, samples, airtime_samples, bytes;
+            get_queue_depth(pages, samples, airtime_samples, bytes);
+            const double airtime = (double)airtime_samples / d_symrate;
+            bool busy = false;
+            double retry = 0.0;     // seconds
+
+            if(d_max_queue_seconds > 0 && airtime >= d_max_queue_seconds) {
+                busy = true;
+                retry = std::max(retry, airtime - d_max_queue_seconds);
+            }
+            if(d_max_queue_bytes > 0 && bytes >= d_max_queue_bytes) {
+                busy = true;
+                // Memory is released as pages go out, roughly in proportion to airtime.
+                retry = std::max(retry, airtime * (bytes - d_max_queue_bytes) / bytes);
+            }
+            if(d_max_queue_pages > 0 && pages >= d_max_queue_pages) {
+                busy = true;
+                retry = std::max(retry, airtime * (pages - d_max_queue_pages + 1) / pages);
+            }
+            if(!busy) {
+                return true;
+            }
+            const unsigned long retry_ms = std::max(1UL, (unsigned long)std::ceil(retry * 1000.0));
+            d_rejected[REJECT_BUSY].add();
+            d_trace.record(TRACE_REJECT, 0, REJECT_BUSY);
+            beeps_output(cmdid + " BUSY " + std::to_string(retry_ms) + "\n");
+            report_queue_depth(pages, airtime_samples, bytes);
+            return false;
         }
 
+		void flexencode_impl::beeps_output(string const &msgtext) {
+            const char *msg = msgtext.c_str();
+			pmt::pmt_t pdu = pmt::cons(pmt::make_dict(), pmt::init_u8vector(strlen(msg), (const uint8_t *)msg));
+			message_port_pub(pmt::mp("beeps_output"), pdu);
+            if(d_output_hook) {
+                d_output_hook(msgtext);
+            }
+
+		}
         /**
-         * Make a short-address word.
+         * Find the output port for a page on the given frequency.  Without a
+         * channel map everything goes to output 0 (which retunes as needed);
+         * with one, the frequency has to match a channel to within 1 Hz.
          *
-         * Returns a reversed 32-bit word (LSB of ret val is the parity bit), or 0 if
-         * error.
+         * Returns -1 if no channel matches.
          */
-        uint32_t
-        make_short_address(uint32_t address) {
-            if(address >= 32769 && address <= 1966080) {
-                uint32_t dw = 0;
-                dw |= (address & 0x1FFFFF);
-                uint32_t encoded = encodeword(reverse_bits32(dw));
-                return encoded;
-            } else {
+        int
+        flexencode_impl::channel_for_freq(double freq) {
+            if(d_channel_freqs.empty()) {
                 return 0;
             }
+            for(size_t i = 0; i < d_channel_freqs.size(); i++) {
+                if(std::fabs(d_channel_freqs[i] - freq) < 1.0) {
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+        transmission::sptr
+        flexencode_impl::cache_lookup(const string &key) {
+            std::lock_guard<std::mutex> lock(d_cache_mutex);
+            transmission::sptr tx = d_cache.get(key);
+            if(tx) {
+                d_cache_hits.add();
+            } else {
+                d_cache_misses.add();
+            }
+            return tx;
         }
 
         /**
-         * Make a numeric vector word.
-         *
-         * NOTE: nwords is not the total number of words in the message; it's the value
-         * to be written into the word (the total number is nwords+1)
-         *
-         * Returns a reversed 32-bit word (LSB of ret val is the parity bit).
+         * Start a parsed page command on its way to the output queue.  With
+         * encoder threads running, it's handed to one of them; otherwise it's
+         * encoded right here.  Either way, jobs are committed in the order
+         * they were submitted (see commit_job()).
          */
-        uint32_t
-        make_numeric_vector(uint32_t vector_type, uint32_t message_start, uint32_t nwords, uint32_t cksum) {
-            uint32_t dw = 0;
-            dw |= (vector_type & 0x7) << 4;
-            dw |= (message_start & 0x7f) << 7;
-            dw |= (nwords & 0x7) << 14;
-            dw |= (cksum & 0xf) << 17;
-            add_flex_checksum(dw);
-            uint32_t encoded = encodeword(reverse_bits32(dw));
-            return encoded;
+        void
+        flexencode_impl::submit_job(shared_ptr<encode_job> job) {
+            job->seq = d_next_job++;
+            job->replay_id = d_replay_id;
+            d_replay_id = 0;
+            d_jobs_inflight++;
+            {
+                std::lock_guard<std::mutex> lock(d_commit_mutex);
+                d_uncommitted[job->seq] = job;
+            }
+            {
+                std::lock_guard<std::mutex> lock(d_jobs_mutex);
+                if(d_workers_running) {
+                    d_jobs.push_back(job);
+                    d_jobs_cond.notify_one();
+                    return;
+                }
+            }
+            run_job(*job);
+            commit_job(job);
         }
 
         /**
-         * Make an alphanumeric vector word.
-         *
-         * NOTE: Unlike with numeric vector words, the nwords parameter is actually the
-         * total number of message words.
-         *
-         * Returns a reversed 32-bit word (LSB of ret val is the parity bit).
+         * Encode a job's page (or find it in the cache).  Runs on any thread:
+         * everything it touches is either the job's own or locked.
          */
-        uint32_t
-        make_alphanumeric_vector(uint32_t message_start, uint32_t nwords) {
-            uint32_t dw = 0;
-            dw |= (0x5) << 4;
-            dw |= (message_start & 0x7f) << 7;
-            dw |= (nwords & 0x7f) << 14;
-            add_flex_checksum(dw);
-            uint32_t encoded = encodeword(reverse_bits32(dw));
-            return encoded;
+        void
+        flexencode_impl::run_job(encode_job &job) {
+            // Not worth encoding if it's going to be dropped anyway.
+            if(job.tx || job.cancelled || d_clock() >= job.expires) {
+                return;
+            }
+            const string key = cache_key(job.protocol, job.msgtype, job.codes, job.message);
+            job.tx = cache_lookup(key);
+            if(job.tx) {
+                return;
+            }
+            core::page pg;
+            if(!core::parse_protocol(job.protocol, pg.protocol)) {
+                return;
+            }
+            pg.type = (core::msgtype_t)job.msgtype;
+            pg.capcodes = job.codes;
+            pg.message = job.message;
+            core::encoded_page encoded;
+            string error;
+            const auto start = std::chrono::steady_clock::now();
+            const bool ok = core::encode(pg, encoded, &error);
+            record_encode_time(start);
+            if(!ok) {
+                d_logger->warn("can't encode page: {}", error);
+                return;
+            }
+            d_codewords.add(encoded.codewords);
+            if(job.msgtype == Auto && encoded.type == core::Numeric) {
+                d_auto_numeric.add();
+                d_auto_saved_us.add((uint64_t)(encoded.auto_saved * 1e6 + 0.5));
+            }
+            job.tx = transmission::from_bits(std::move(encoded.bits), encoded.nbits, encoded.baudrate);
+            std::lock_guard<std::mutex> lock(d_cache_mutex);
+            d_cache.put(key, job.tx);
         }
 
+        /**
+         * A job is done encoding.  Commit it, and any later jobs that finished
+         * while waiting for it, to the output queue in submission order, so
+         * that pages go out in the order they arrived however long each one
+         * took to encode.  Jobs cancelled or expired in the meantime are
+         * dropped here.
+         */
         void
-        interleave(uint32_t *words, uint8_t *interleaved) {
-            unsigned int il = 0;
-            for(unsigned int i = 0; i < 32; i++) {
-                for(unsigned int j = 0; j < 8; j++) {
-                    interleaved[il++] = ((words[j] & 0x80000000) == 0x80000000) ? 1 : 0;
-                    words[j] = words[j] << 1;
+        flexencode_impl::commit_job(shared_ptr<encode_job> job) {
+            std::lock_guard<std::mutex> lock(d_commit_mutex);
+            job->encoded = true;
+            const auto now = d_clock();
+            for(auto it = d_uncommitted.begin(); it != d_uncommitted.end() && it->second->encoded; it = d_uncommitted.begin()) {
+                const encode_job &next = *it->second;
+                bool queued = false;
+                if(next.cancelled) {
+                    drop_job(next, DROP_CANCELLED);
+                } else if(now >= next.expires) {
+                    drop_job(next, DROP_EXPIRED);
+                } else if(next.tx) {
+                    queued = accept_page(next);
+                } else {
+                    if(next.replay_id != 0) {
+                        d_logger->warn("journal: dropped page that can't be encoded again: {}", boost::algorithm::join(next.tokens, " "));
+                        d_journal->done_later(next.replay_id);
+                    }
+                    forget_page(next.dedup_key);
+                    reject_command(next.tokens[1], REJECT_ENCODE);
+                }
+                d_uncommitted.erase(it);
+                // A queued page was taken off d_jobs_inflight by add_command_id().
+                if(!queued) {
+                    d_jobs_inflight--;
                 }
             }
-            assert(il == 256);
         }
 
+        /**
+         * Parse the options after a page command's fixed arguments (starting
+         * at tokens[optarg]), then check that the page isn't a duplicate.
+         * The only option is "ttl=<seconds>", which overrides d_page_ttl for
+         * this page.  Returns false, having answered the command, if it's
+         * turned away.
+         */
         bool
-        flexencode_impl::queue_flex_batch(const msgtype_t msgtype, const vector<uint32_t> &codes, const char *msgbody) {
-            d_baudrate = 1600;
-
-            static const shared_ptr<bvec> bit_sync_1 = get_vec("10101010101010101010101010101010");
-            static const shared_ptr<bvec> bs =         get_vec("1010101010101010");
-            static const shared_ptr<bvec> bs_inv =     get_vec("0101010101010101");
-            static const shared_ptr<bvec> a1 =         get_vec("01111000111100110101100100111001");
-            static const shared_ptr<bvec> a1_inv =     get_vec("10000111000011001010011011000110");
-            static const shared_ptr<bvec> ar =         get_vec("11001011001000000101100100111001");
-            static const shared_ptr<bvec> ar_inv =     get_vec("00110100110111111010011011000110");
-            static const shared_ptr<bvec> b          = get_vec("0101010101010101");
-            static const shared_ptr<bvec> cblock =     get_vec("1010111011011000010001010001001001111011");
-            uint32_t idle_word = 0;
-            encodeword(reverse_bits32(idle_word));
-            uint32_t idle_word2 = 0x1FFFFF;
-            encodeword(reverse_bits32(idle_word2));
-            boost::mutex::scoped_lock lock(bitqueue_mutex);
-
-            for(unsigned int i = 0; i < 35; i++) {
-                queue(bs);
-                queue(ar);
-                queue(bs_inv);
-                queue(ar_inv);
-            }
-
-            for(unsigned int frame = 0; frame < 1; frame++) {
-                uint32_t fiw = make_fiw(0, frame, 0, 0, 0x0);
-                queue(bit_sync_1);
-                queue(a1);
-                queue(b);
-                queue(a1_inv);
-                printf("XXX FIW %x\n", fiw);
-                queue(fiw);
-                queue(cblock);
-                printf("XXX before blocks sz %lu\n", d_bitqueue.size());
-
-                vector<uint32_t> addrwords;
-                vector<uint32_t> vecwords;
-                vector<uint32_t> msgwords;
-
-                for(auto it = codes.begin(); it != codes.end(); it++) {
-                    uint32_t addr = make_short_address(*it + 32768);
-                    if(addr == 0) {    // 0 is not a valid codeword for what we're doing here, so we use it as an error
-                        std::cerr << "couldn't get address for capcode " << *it << std::endl;
-                        return false;
-                    }
-                    std::cout << "XXX adding word for address " << *it << std::endl;
-                    addrwords.push_back(addr);
-                }
-                std::cout << "XXX address words size " << addrwords.size() << std::endl;
-
-                vector<uint32_t> allwords;
-                allwords.push_back(make_biw1(0, 0, 1+addrwords.size(), 0, 0));
-                //allwords.push_back(make_biwymd(25, 5, 29));
-                //allwords.push_back(make_biwhms(13, 37, 0));
-                allwords.insert(allwords.end(), addrwords.begin(), addrwords.end());
-
-                uint32_t new_msg_checksum;
-                if(msgtype == Alpha) {
-                    if(make_alphanumeric_msg(1, allwords.size()+1, msgbody, vecwords, msgwords) == false) {
-                        std::cerr << "couldn't make alphanumeric message word" << std::endl;
-                        return false;
-                    }
-                } else if(msgtype == Numeric) {
-                    if(make_standard_numeric_msg(1, allwords.size()+1, msgbody, vecwords, msgwords, new_msg_checksum) == false) {
-                        std::cerr << "couldn't make numeric message word" << std::endl;
-                        return false;
-                    }
-                } else {
-                    std::cerr << "WARNING: invalid msgtype " << msgtype << std::endl;
-                    return false;
+        flexencode_impl::prepare_page(encode_job &job, size_t optarg) {
+            const string &cmdid = job.tokens[1];
+            double ttl = d_page_ttl;
+            for(size_t i = optarg; i < job.tokens.size(); i++) {
+                const string &opt = job.tokens[i];
+                bool ok = opt.compare(0, 4, "ttl=") == 0;
+                if(ok) {
+                    const char *val = opt.c_str() + 4;
+                    char *end;
+                    errno = 0;
+                    ttl = strtod(val, &end);
+                    ok = errno == 0 && end != val && *end == '\0' && std::isfinite(ttl) && ttl >= 0;
                 }
-                allwords.insert(allwords.end(), vecwords.begin(), vecwords.end());
-                allwords.insert(allwords.end(), msgwords.begin(), msgwords.end());
-                while(allwords.size() < 88) {
-                    if((allwords.size() % 2) == 0) {
-                        allwords.push_back(idle_word);
-                    } else {
-                        allwords.push_back(idle_word2);
-                    }
+                if(!ok) {
+                    d_logger->warn("beeps message: invalid option: {}", opt);
+                    reject_command(cmdid, REJECT_INVALID);
+                    return false;
                 }
-                auto blockiter = allwords.begin();
-                for(unsigned int block = 0; block < 11; block++) {
-                    assert(blockiter != allwords.end());
-                    uint32_t blockwords[8];
-                    uint8_t interleaved[256];
-                    for(int i = 0; i < 8; i++) {
-                        blockwords[i] = *blockiter;
-                        blockiter++;
-                    }
-                    interleave(blockwords, interleaved);
-                    queue(interleaved, 256);
-                }
-
-
-// XXX REMOVE
-//                for(unsigned int block = 0; block < 11; block++) {
-//                    uint32_t blockwords[8];
-//                    uint8_t interleaved[256];
-//
-//                    uint32_t biw1 = make_biw1(0, 0, 2, 0, 0);
-//                    uint32_t addr1 = make_short_address(1337331 + 32768);
-//                    
-//                    blockwords[0] = biw1;
-//                    blockwords[1] = addr1;
-//
-//
-//                    uint32_t msgx = (0x6 << 2) | (0x9 << 6) | (0xc << 10) | (0xc << 14);
-//                    uint32_t binsum = (msgx & 0xff)
-//                        + ((msgx >> 8) & 0xff)
-//                        + ((msgx >> 16) & 0x1f);
-//                    binsum &= 0xff;
-//                    uint32_t tempsum = (binsum & 0x3f) + ((binsum >> 6) & 0x3);
-//                    uint32_t msg_checksum = (~(tempsum) & 0x3f);
-//
-//                    msgx |= ((msg_checksum >> 4) & 0x3);
-//                    uint32_t encoded_msg = encodeword(reverse_bits32(msgx));
-//                    std::cout << "XXX encoded_msg: " << u32tostring(encoded_msg) << std::endl;
-//
-//
-//                    
-//                    // XXX: TRY nwords 0!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-//                    blockwords[2] = make_numeric_vector(3, 3, 0, (msg_checksum & 0xf));
-//                    blockwords[3] = encoded_msg;
-//                    blockwords[4] = idle_word;
-//                    blockwords[5] = idle_word2;
-//                    blockwords[6] = idle_word;
-//                    blockwords[7] = idle_word2;
-//                    interleave(blockwords, interleaved);
-//                    queue(interleaved, 256);
-//                    printf("XXX after block %u sz %lu\n", block, d_bitqueue.size());
-//                }
             }
-            return true;
-        }
+            const auto now = d_clock();
+            job.expires = ttl > 0
+                ? now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(ttl))
+                : std::chrono::steady_clock::time_point::max();
 
-        bool
-        flexencode_impl::make_alphanumeric_msg(unsigned int num_address_words, unsigned int message_start, const string msg, vector<uint32_t> &vecwords, vector<uint32_t> &msgwords) {
-            assert(num_address_words == 1);     // XXX no long address yet
-            const int len = msg.length();
-            if(len < 1 || len > 252) {
-                std::cerr << "warning: invalid alphanumeric message len: " << len << std::endl;
-                return false;
+            // A page replayed from the journal was checked the first time.
+            if(d_dedup_window <= 0 || job.tx || d_replay_id != 0) {
+                return true;
+            }
+            // The same message to the same pagers on another protocol or
+            // channel is a different page.
+            std::stringstream key;
+            key << job.protocol << " " << job.msgtype << " " << job.chan << " " << std::fixed << job.freq << " ";
+            for(size_t i = 0; i < job.codes.size(); i++) {
+                key << (i ? "," : "") << job.codes[i];
             }
-            uint32_t msgbuf[85];
-            for(int i = 0; i < 85; i++) {
-                msgbuf[i] = 0;
-            }
-
-            // First, fill in the actual message characters.  
-            uint32_t wordidx = 1;
-            uint32_t bitidx = 7;
-            for(int i = 0; i < len; i++) {
-                msgbuf[wordidx] |= ((msg[i] & 0x7f) << bitidx);
-                bitidx += 7;
-                if(bitidx == 21) {
-                    bitidx = 0;
-                    wordidx++;
-                }
-            }
-            if(bitidx == 7) {
-                msgbuf[wordidx] |= (((0x03) << 7) | ((0x03) << 14));
-                wordidx++;
-            } else if(bitidx == 14) {
-                msgbuf[wordidx] |= ((0x03) << 14);
-                wordidx++;
-            }
-            // Then, calculate the signature (S) over the message.
-            // XXX: should we include 0x03 padding in this calculation?
-            uint32_t sig = 0;
-            for(int i = 1; i < wordidx; i++) {
-                sig += (msgbuf[wordidx] & 0x7f);
-                sig += ((msgbuf[wordidx] >> 7) & 0x7f);
-                sig += ((msgbuf[wordidx] >> 14) & 0x7f);
-            }
-            sig = ~sig;
-            msgbuf[1] |= (sig & 0x7f);
-
-            msgbuf[0] |= (0x3 << 11);       // F = 0b11, 3.8.8.3
-
-            // Now, we calculate the fragment checksum K.
-            uint32_t binsum = 0;
-            for(uint32_t i = 0; i < wordidx; i++) {
-                uint32_t mw = msgbuf[i];
-                uint32_t wordsum = (mw & 0xff) + ((mw >> 8) & 0xff) + ((mw >> 16) & 0x1f);
-                binsum += wordsum;
-            }
-            uint32_t msg_checksum = (~(binsum) & 0x3ff);
-            msgbuf[0] |= (msg_checksum & 0x3ff);
-
-            uint32_t vecword = make_alphanumeric_vector(message_start, wordidx);
-            vecwords.push_back(vecword);
-            for(uint32_t i = 0; i < wordidx; i++) {
-                msgwords.push_back(encodeword(reverse_bits32(msgbuf[i])));
+            key << " " << job.message;
+            job.dedup_key = transmission_cache::hash(key.str());
+            std::lock_guard<std::mutex> lock(d_recent_mutex);
+            if(!d_recent.insert(job.dedup_key, now)) {
+                d_rejected[REJECT_DUPLICATE].add();
+                d_trace.record(TRACE_REJECT, 0, REJECT_DUPLICATE);
+                beeps_output(cmdid + " DUPLICATE\n");
+                return false;
             }
             return true;
         }
 
-        bool
-        flexencode_impl::make_standard_numeric_msg(unsigned int num_address_words, unsigned int message_start, const string msg, vector<uint32_t> &vecwords, vector<uint32_t> &msgwords, uint32_t &checksum) {
-            assert(num_address_words == 1);     // XXX no long address yet
-            const int len = msg.length();
-            if(len < 1 || len > 41) {
-                std::cerr << "warning: invalid numeric message len: " << len << std::endl;
-                return false;
-            }
-            uint32_t msgbuf[8];
-            for(int i = 0; i < 8; i++) {
-                msgbuf[i] = 0;
-            }
-            uint32_t curbit = 2;
-            for(int i = 0; i < len; i++) {
-                char c = msg[i];
-                uint32_t val = 0;
-                switch(c) {
-                    case '0':
-                        val = 0;
-                        break;
-                    case '1':
-                        val = 1;
-                        break;
-                    case '2':
-                        val = 2;
-                        break;
-                    case '3':
-                        val = 3;
-                        break;
-                    case '4':
-                        val = 4;
-                        break;
-                    case '5':
-                        val = 5;
-                        break;
-                    case '6':
-                        val = 6;
-                        break;
-                    case '7':
-                        val = 7;
-                        break;
-                    case '8':
-                        val = 8;
-                        break;
-                    case '9':
-                        val = 9;
-                        break;
-                    case 'S':
-                    case 'A':
-                        val = 0xa;
-                        break;
-                    case 'U':
-                    case 'B':
-                        val = 0xb;
-                        break;
-                    case ' ':
-                        val = 0xc;
-                        break;
-                    case '-':
-                    case 'C':
-                        val = 0xd;
-                        break;
-                    case ']':
-                    case ')':
-                    case 'D':
-                        val = 0xe;
-                        break;
-                    case '[':
-                    case '(':
-                    case 'E':
-                        val = 0xf;
-                        break;
-                    default:
-                        std::cerr << "warning: invalid character in message: " << c << std::endl;
-                        return false;
-                }
-                const int wordidx = curbit / 21;
-                const int bitidx = curbit % 21;
-                if((21 - bitidx) >= 4) {
-                    msgbuf[wordidx] |= (val << bitidx);
-                } else {
-                    const int firstpart = 21-bitidx;
-                    const uint32_t firstmask = ((uint32_t)~(0)) >> (32-firstpart);
-                    msgbuf[wordidx] |= ((val & firstmask) << bitidx);
-                    msgbuf[wordidx+1] |= (val >> firstpart);
-                }
-                curbit += 4;
+        // A page that isn't going out after all no longer counts against
+        // the duplicate window.
+        void
+        flexencode_impl::forget_page(uint64_t dedup_key) {
+            if(dedup_key != 0) {
+                std::lock_guard<std::mutex> lock(d_recent_mutex);
+                d_recent.erase(dedup_key);
             }
+        }
 
-            // Now, count the number of words.  If curbit is at an even word boundary
-            // (e.g. at the 3rd word or the 7th word -- see 3.8.8.1), then we don't need
-            // to do any filling.  Otherwise, fill all remaining 4-char blocks with 0xc
-            // and all remaining spaces with zeroes (we set these all to 0 initially so
-            // this is done for us)
+        static const char *drop_responses[DROP_NREASONS] = { "EXPIRED", "CANCELLED" };
 
-            uint32_t nwords = 0;
-            if((curbit % 21) == 0) {
-                nwords = curbit / 21;
-            } else {
-                const uint32_t fillidx = (curbit / 21);
-                const uint32_t nspaces = (21-(curbit % 21)) / 4;
-                for(uint32_t i = 0; i < nspaces; i++) {
-                    const int bitidx = curbit % 21;
-                    assert((21-bitidx) >= 4);
-                    msgbuf[fillidx] |= (0xc << bitidx);
-                    curbit += 4;
-                }
-                nwords = fillidx+1;
+        // Drop a job that was cancelled or expired before it was committed.
+        void
+        flexencode_impl::drop_job(const encode_job &job, drop_reason reason) {
+            if(job.replay_id != 0) {
+                d_journal->done_later(job.replay_id);
             }
-            assert(message_start+nwords <= 88);
+            forget_page(job.dedup_key);
+            d_dropped[reason].add();
+            d_trace.record(TRACE_DROP, job.chan, reason);
+            beeps_output(job.tokens[1] + " " + drop_responses[reason] + "\n");
+        }
 
-            // Now, calculate the checksum according to 3.8.8.1.
-            uint32_t binsum = 0;
-            for(uint32_t i = 0; i < nwords; i++) {
-                uint32_t mw = msgbuf[i];
-                uint32_t wordsum = (mw & 0xff) + ((mw >> 8) & 0xff) + ((mw >> 16) & 0x1f);
-                binsum += wordsum;
+        /**
+         * Drop a page from a channel's pending list, along with its ack.
+         * Must be called with bitqueue_mutex held.
+         */
+        void
+        flexencode_impl::drop_page(int chan, std::list<pending_page>::iterator page, drop_reason reason) {
+            channel_state &cs = d_chans[chan];
+            cs.pending_samples -= tx_samples(*page->tx);
+            cs.pending_bytes -= page->tx->memory();
+            if(d_journal && page->journal_id != 0) {
+                d_journal->done_later(page->journal_id);
             }
-            binsum &= 0xff;
-            uint32_t tempsum = (binsum & 0x3f) + ((binsum >> 6) & 0x3);
-            uint32_t msg_checksum = (~(tempsum) & 0x3f);
-
-            // Now that we've calculated the checksum, we can fill in the first two bits
-            // (which are the two most-significant bits in the checksum value)
-            msgbuf[0] |= ((msg_checksum >> 4) & 0x3);
-
-            uint32_t vecword = make_numeric_vector(3, message_start, nwords-1, (msg_checksum & 0xf));
-
-            checksum = msg_checksum;
-            vecwords.push_back(vecword);
-            for(uint32_t i = 0; i < nwords; i++) {
-                msgwords.push_back(encodeword(reverse_bits32(msgbuf[i])));
+            {
+                boost::mutex::scoped_lock lock(cmdlist_mutex);
+                for(auto it = d_cmdlist.begin(); it != d_cmdlist.end(); it++) {
+                    if(it->seq == page->seq) {
+                        d_cmdlist.erase(it);
+                        break;
+                    }
+                }
             }
-            return true;
+            forget_page(page->dedup_key);
+            d_dropped[reason].add();
+            d_trace.record(TRACE_DROP, chan, reason, page->seq);
+            beeps_output(page->cmdid + " " + drop_responses[reason] + "\n");
+            cs.pending.erase(page);
         }
 
-
-#define POCSAG_SYNCWORD 0x7CD215D8
-#define POCSAG_IDLEWORD 0x7A89C197
-        bool
-        flexencode_impl::queue_pocsag_batch(msgtype_t msgtype, unsigned int baudrate, unsigned int capcode, std::string message) {
-            try {
-                d_baudrate = baudrate;
-                std::vector<uint32_t> msgwords;
-                uint32_t functionbits = 0;
-                switch(msgtype) {
-                    case Numeric:
-                        make_numeric_message(message, msgwords);
-                        functionbits = 0;
-                        break;
-                    case Alpha:
-                        make_alpha_message(message, msgwords);
-                        functionbits = 3;
-                        break;
-                    default:
-                        throw std::runtime_error("Invalid message type specified.");
-                }
-                msgwords.push_back(POCSAG_IDLEWORD);
-
-                static const shared_ptr<bvec> preamble = get_vec("101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010");
-                const uint32_t addrtemp = (capcode >> 3) << 13 | ((functionbits & 3) << 11);
-                const uint32_t addrword = encodeword(addrtemp);
-                const uint32_t frameoffset = capcode & 7;
-
-                assert((addrword & 0xFFFFF800) == addrtemp);
-
-                queue_pocsag(preamble);
-                queue_pocsag(POCSAG_SYNCWORD);
-                
-                for(int i = 0; i < frameoffset; i++) {
-                    queue_pocsag(POCSAG_IDLEWORD);
-                    queue_pocsag(POCSAG_IDLEWORD);
-                }
-                queue_pocsag(addrword);
-                std::vector<uint32_t>::iterator it = msgwords.begin();
-
-                for(int i = (frameoffset * 2)+1; i < 16; i++) {
-                    if(it != msgwords.end()) {
-                        queue_pocsag(*it);
-                        it++;
-                    } else {
-                        queue_pocsag(POCSAG_IDLEWORD);
+        /**
+         * cancel <messagetag>
+         *
+         * Drop every page with this tag that hasn't gone on the air yet,
+         * wherever it is: scheduled, being encoded or queued.  Each one is
+         * answered with "<messagetag> CANCELLED" (pages still being encoded
+         * are answered when their turn to be queued comes).  If there's
+         * nothing left to cancel, the answer is "<messagetag> ERROR".
+         */
+        void
+        flexencode_impl::cancel_command(const string &cmdid) {
+            size_t cancelled = 0;
+            size_t scheduled;
+            {
+                std::lock_guard<std::mutex> lock(d_sched_mutex);
+                scheduled = d_scheduled.remove_if([&cmdid](const vector<string> &cmd) { return cmd[1] == cmdid; });
+            }
+            for(size_t i = 0; i < scheduled; i++) {
+                d_dropped[DROP_CANCELLED].add();
+                d_trace.record(TRACE_DROP, 0, DROP_CANCELLED);
+                beeps_output(cmdid + " " + drop_responses[DROP_CANCELLED] + "\n");
+            }
+            cancelled += scheduled;
+            // Anything that isn't in d_uncommitted by now has been queued.
+            {
+                std::lock_guard<std::mutex> lock(d_commit_mutex);
+                for(auto &it : d_uncommitted) {
+                    if(it.second->tokens[1] == cmdid && !it.second->cancelled) {
+                        it.second->cancelled = true;
+                        cancelled++;
                     }
                 }
-                while(it != msgwords.end()) {
-                    queue_pocsag(POCSAG_SYNCWORD);
-                    for(int i = 0; i < 16; i++) {
-                        if(it != msgwords.end()) {
-                            queue_pocsag(*it);
-                            it++;
-                        } else {
-                            queue_pocsag(POCSAG_IDLEWORD);
+            }
+            {
+                boost::mutex::scoped_lock lock(bitqueue_mutex);
+                for(size_t chan = 0; chan < d_chans.size(); chan++) {
+                    std::list<pending_page> &pending = d_chans[chan].pending;
+                    for(auto it = pending.begin(); it != pending.end(); ) {
+                        auto page = it++;
+                        if(page->cmdid == cmdid) {
+                            drop_page(chan, page, DROP_CANCELLED);
+                            cancelled++;
                         }
                     }
                 }
-                return true;
-            } catch (std::exception &exc) {
-                return false;
+            }
+            if(cancelled == 0) {
+                d_logger->warn("beeps message: nothing to cancel for tag {}", cmdid);
+                reject_command(cmdid, REJECT_INVALID);
             }
         }
 
-
-        void 
-        flexencode_impl::queue(uint8_t *arr, size_t sz) {
-            for(size_t i = 0; i < sz; i++) {
-                queuebit(arr[i] == 0 ? 0 : 1);
+        // Encoder thread: run jobs until stop() and the queue is empty.
+        void
+        flexencode_impl::worker_loop() {
+            for(;;) {
+                shared_ptr<encode_job> job;
+                {
+                    std::unique_lock<std::mutex> lock(d_jobs_mutex);
+                    d_jobs_cond.wait(lock, [this] { return d_workers_stop || !d_jobs.empty(); });
+                    if(d_jobs.empty()) {
+                        return;
+                    }
+                    job = d_jobs.front();
+                    d_jobs.pop_front();
+                }
+                run_job(*job);
+                commit_job(job);
             }
         }
 
-        void 
-        flexencode_impl::queue_pocsag(shared_ptr<bvec> bvptr) {
-            for(unsigned int i = 0; i < bvptr->size(); i++) {
-                queuebit((*bvptr)[i] ? 0 : 1);
-            }
+        /**
+         * Hand an encoded page over to the scheduler, and add it to the
+         * pages waiting for their ack.  Both happen under bitqueue_mutex, so
+         * the page can't be dropped before its ack is there to go with it.
+         */
+        void
+        flexencode_impl::commit_page(const encode_job &job, uint64_t journal_id) {
+            boost::mutex::scoped_lock lock(bitqueue_mutex);
+            channel_state &cs = d_chans[job.chan];
+            cs.pending.push_back(pending_page());
+            pending_page &page = cs.pending.back();
+            page.seq = d_next_seq++;
+            page.freq = d_channel_freqs.empty() ? job.freq : d_channel_freqs[job.chan];
+            page.tx = job.tx;
+            page.journal_id = journal_id;
+            page.cmdid = job.tokens[1];
+            page.expires = job.expires;
+            page.dedup_key = job.dedup_key;
+            cs.pending_samples += tx_samples(*job.tx);
+            cs.pending_bytes += job.tx->memory();
+            d_trace.record(TRACE_ACCEPT, job.chan, 0, page.seq);
+            add_command_id(job.tokens[1], journal_id, page.seq);
         }
-        void 
-        flexencode_impl::queue_pocsag(uint32_t val) {
-            for(int i = 0; i < 32; i++) {
-                queuebit(((val & 0x80000000) == 0x80000000) ? 0 : 1);
-                val = val << 1;
+
+        /**
+         * Accept an encoded page: write its command to the journal, if there
+         * is one, and queue it.  A page being replayed from the journal keeps
+         * its journal id.  Returns false, having answered the command, if it
+         * couldn't be journaled.
+         */
+        bool
+        flexencode_impl::accept_page(const encode_job &job) {
+            uint64_t journal_id = job.replay_id;
+            if(journal_id == 0 && d_journal) {
+                try {
+                    journal_id = d_journal->accepted(boost::algorithm::join(job.tokens, " "));
+                } catch(std::exception &exc) {
+                    d_logger->warn("beeps message: can't journal page: {}", exc.what());
+                    forget_page(job.dedup_key);
+                    reject_command(job.tokens[1], REJECT_JOURNAL);
+                    return false;
+                }
             }
+            commit_page(job, journal_id);
+            return true;
         }
 
-        void 
-        flexencode_impl::queue(shared_ptr<bvec> bvptr) {
-            for(unsigned int i = 0; i < bvptr->size(); i++) {
-                queuebit((*bvptr)[i]);
+        /**
+         * Queue the pages left unfinished in the journal by the last run, in
+         * their original order.  A page that can't be queued again is dropped
+         * from the journal.
+         */
+        void
+        flexencode_impl::replay_journal() {
+            const vector<page_journal::entry> pages = d_journal->take_recovered();
+            if(!pages.empty()) {
+                d_logger->info("replaying {} unfinished pages from the journal", pages.size());
             }
-        }
-        void 
-        flexencode_impl::queue(uint32_t val) {
-            for(int i = 0; i < 32; i++) {
-                queuebit(((val & 0x80000000) == 0x80000000) ? 1 : 0);
-                val = val << 1;
+            for(const auto &page : pages) {
+                vector<string> tokens;
+                boost::split(tokens, page.cmd, boost::is_space(), boost::token_compress_on);
+                if(tokens.size() < 2) {
+                    d_journal->done(page.id);
+                    continue;
+                }
+                d_replay_id = page.id;
+                {
+                    std::lock_guard<std::mutex> lock(d_command_mutex);
+                    run_command(tokens);
+                }
+                // If it was turned away before it got to submit_job(), it's
+                // still ours to drop.
+                if(d_replay_id != 0) {
+                    d_logger->warn("journal: dropped page that can't be queued again: {}", page.cmd);
+                    d_journal->done(page.id);
+                    d_replay_id = 0;
+                }
             }
         }
 
-
-
-        flexencode_impl::flexencode_impl()
-          : d_baudrate(1600), d_symrate(38400), 
-          sync_block("flexencode",
-                  io_signature::make(0, 0, 0),
-                  io_signature::make(1, 1, sizeof (unsigned char)))
-        {
-            if(d_symrate % d_baudrate != 0) {
-                std::cerr << "Output symbol rate must be evenly divisible by baud rate!" << std::endl;
-                throw std::runtime_error("Output symbol rate is not evenly divisible by baud rate");
+        /**
+         * Start sending the next pending page for a channel.  Must be called
+         * with bitqueue_mutex held, and only when the channel is idle.
+         *
+         * Pages are grouped by frequency: while there are pages for the
+         * current frequency that arrived before the current group started,
+         * they go first.  Otherwise the oldest pending page is next; if it
+         * is on another frequency, a tx_freq tag is put on its first symbol
+         * (offset is its index within this work() call) so the sink retunes
+         * exactly between the two pages.  Bounding each group by arrival
+         * order keeps a busy frequency from starving the others.
+         *
+         * A page whose TTL has run out by the time it comes up is dropped
+         * instead, and the next one is tried.
+         *
+         * Returns false if there's nothing left to send.
+         */
+        bool
+        flexencode_impl::start_next_page(int chan, int offset) {
+            channel_state &cs = d_chans[chan];
+            const auto now = d_clock();
+            std::list<pending_page>::iterator next;
+            for(;;) {
+                if(cs.pending.empty()) {
+                    return false;
+                }
+                next = cs.pending.begin();
+                for(auto it = cs.pending.begin(); it != cs.pending.end() && it->seq < cs.group_cutoff; it++) {
+                    if(it->freq == cs.curfreq) {
+                        next = it;
+                        break;
+                    }
+                }
+                if(now < next->expires) {
+                    break;
+                }
+                drop_page(chan, next, DROP_EXPIRED);
             }
-            //queue_flex_batch(Alpha, vector<uint32_t>(1, 1337331), "started");  // XXX
-
-            message_port_register_out(pmt::mp("beeps_output"));
-            message_port_register_out(pmt::mp("cmds_out"));
-            message_port_register_in(pmt::mp("beeps"));
-            /*set_msg_handler(pmt::mp("beeps"),
-                std::bind(&flexencode_impl::beeps_message, this, std::placeholders::_1)
-            );*/
-            set_msg_handler(pmt::mp("beeps"), [this](pmt::pmt_t msg) { this->beeps_message(msg); });
-        }
-        void
-        flexencode_impl::add_command_id(string cmdid) {
-            boost::mutex::scoped_lock lock(cmdlist_mutex);
-            d_cmdlist.push_back(cmdid);
-        }
-
-        void 
-        flexencode_impl::clear_cmdid_queue() {
-            boost::mutex::scoped_lock lock(cmdlist_mutex);
-            while(!d_cmdlist.empty()) {
-                string cmdid = d_cmdlist.back();
-                beeps_output(cmdid + " OK\n");
-                d_cmdlist.pop_back();
+            if(next->freq != cs.curfreq || next->seq >= cs.group_cutoff) {
+                cs.group_cutoff = d_next_seq;
+            }
+            if(next->freq != cs.curfreq) {
+                cs.curfreq = next->freq;
+                add_item_tag(chan, nitems_written(chan) + offset, pmt::mp("tx_freq"), pmt::from_double(cs.curfreq), alias_pmt());
+                if(d_retune_messages) {
+                    tune_target(cs.curfreq);
+                }
             }
+            d_trace.record(TRACE_PAGE_START, chan, 0, next->seq);
+            cs.pending_samples -= tx_samples(*next->tx);
+            cs.pending_bytes -= next->tx->memory();
+            cs.current = next->tx;
+            cs.current_seq = next->seq;
+            cs.current_pos = 0;
+            cs.pending.erase(next);
+            return true;
         }
-		void flexencode_impl::beeps_output(string const &msgtext) {
-            const char *msg = msgtext.c_str();
-			pmt::pmt_t pdu = pmt::cons(pmt::make_dict(), pmt::init_u8vector(strlen(msg), (const uint8_t *)msg));
-			message_port_pub(pmt::mp("beeps_output"), pdu);
 
-		}
         void
         flexencode_impl::tune_target(double freqhz) {
             pmt::pmt_t command = pmt::cons( // Make a pair
@@ -716,7 +769,7 @@ namespace gr {
         flexencode_impl::beeps_message(pmt::pmt_t msg) {
 			pmt::pmt_t cmdvec = cdr(msg);
 			if(is_u8vector(cmdvec) == false) {
-				std::cerr << "WARNING beeps message: got invalid message: " << msg << std::endl;
+				d_logger->warn("beeps message: got invalid message: {}", pmt::write_string(msg));
                 beeps_output("BADCMD\n");
 				return;
 			}
@@ -731,66 +784,78 @@ namespace gr {
 
             vector<string> tokens;
             boost::split(tokens, cmdstr, boost::is_space(), boost::token_compress_on);
+            std::lock_guard<std::mutex> lock(d_command_mutex);
+            run_command(tokens);
+        }
+
+        // Run one command.  Must be called with d_command_mutex held.
+        void
+        flexencode_impl::run_command(const vector<string> &tokens) {
             if(tokens.size() < 1 || tokens[0].length() < 1) {
                 return;
             }
             // flex 0 931337500 alpha 1337331 41424344
             // flex 1 931337500 numeric 1337331 3133731337A
             // pocsag512 0 158700000 alpha 425321 41424344
+            // flex 3 931337500 alpha 1337331 41424344 ttl=60
+            // sendin 30 flex 2 931337500 alpha 1337331 41424344
+            // cancel 2
+            // status
+            if(tokens[0].compare("status") == 0) {
+                unsigned long pages, samples, airtime_samples, bytes;
+                get_queue_depth(pages, samples, airtime_samples, bytes);
+                report_queue_depth(pages, airtime_samples, bytes);
+                return;
+            }
             if(tokens[0].compare("flex") == 0 && tokens.size() >= 6) {
                 string cmdid = tokens[1];
                 string freqhz = tokens[2];
                 string msgtype = tokens[3];
                 string capcodestr = tokens[4];
                 string message = tokens[5];
+                if(!admit_command(cmdid)) {
+                    return;
+                }
 
                 errno = 0;
                 unsigned long freq = strtoul(freqhz.c_str(), 0, 10);
                 if((freq == ULONG_MAX || freq == 0) && errno != 0) {
-                    std::cerr << "WARNING beeps message: invalid freq: " << freqhz << std::endl;
-                    beeps_output(cmdid + " ERROR\n");
+                    d_logger->warn("beeps message: invalid freq: {}", freqhz);
+                    reject_command(cmdid, REJECT_INVALID);
                     return;
                 }
-                tune_target(freq);
-                vector<string> capcodes;
-                boost::split(capcodes, capcodestr, boost::is_any_of(","), boost::token_compress_on);
-                if(capcodes.size() < 1 || tokens[0].length() < 1) {
-                    std::cerr << "WARNING beeps message: got bad capcode str: " << capcodestr << std::endl;
-                    beeps_output(cmdid + " ERROR\n");
+                const int chan = channel_for_freq(freq);
+                if(chan < 0) {
+                    d_logger->warn("beeps message: no channel for freq: {}", freqhz);
+                    reject_command(cmdid, REJECT_NO_CHANNEL);
                     return;
                 }
                 vector<uint32_t> codes;
-                for(auto it = capcodes.begin(); it != capcodes.end(); it++) {
-                    errno = 0;
-                    unsigned long code = strtoul((*it).c_str(), 0, 10);
-                    if(code > UINT32_MAX || ((code == ULONG_MAX || code == 0) && errno != 0)) {
-                        std::cerr << "WARNING beeps message: invalid capcode str: " << capcodestr << std::endl;
-                        beeps_output(cmdid + " ERROR\n");
-                        return;
-                    }
-                    codes.push_back(code);
+                if(!parse_capcodes(capcodestr, codes)) {
+                    d_logger->warn("beeps message: invalid capcode str: {}", capcodestr);
+                    reject_command(cmdid, REJECT_INVALID);
+                    return;
                 }
 
 
-                if(msgtype.compare("alpha") == 0) {
-                    string realmsg = hex_decode(message);
-                    if(queue_flex_batch(Alpha, codes, realmsg.c_str()) == false) {
-                        beeps_output(cmdid + " ERROR\n");
-                        return;
-                    }
-                    add_command_id(cmdid);
-                } else if(msgtype.compare("numeric") == 0) {
-                    string realmsg = hex_decode(message);
-                    if(queue_flex_batch(Numeric, codes, realmsg.c_str()) == false) {
-                        beeps_output(cmdid + " ERROR\n");
-                        return;
-                    }
-                    add_command_id(cmdid);
-                } else {
-                    std::cerr << "WARNING beeps message: invalid type: " << msgtype << std::endl;
-                    beeps_output(cmdid + " ERROR\n");
+                msgtype_t msgt;
+                if(!parse_msgtype(msgtype, msgt)) {
+                    d_logger->warn("beeps message: invalid type: {}", msgtype);
+                    reject_command(cmdid, REJECT_INVALID);
                     return;
                 }
+                shared_ptr<encode_job> job(new encode_job());
+                job->tokens = tokens;
+                job->chan = chan;
+                job->freq = freq;
+                job->protocol = tokens[0];
+                job->msgtype = msgt;
+                job->codes = codes;
+                job->message = hex_decode(message);
+                if(!prepare_page(*job, 6)) {
+                    return;
+                }
+                submit_job(job);
             } else if(
                     (tokens[0].compare("pocsag512") == 0
                      || tokens[0].compare("pocsag1200") == 0
@@ -801,107 +866,512 @@ namespace gr {
                 string msgtype = tokens[3];
                 string capcodestr = tokens[4];
                 string message = tokens[5];
+                if(!admit_command(cmdid)) {
+                    return;
+                }
                 errno = 0;
                 unsigned long freq = strtoul(freqhz.c_str(), 0, 10);
                 if((freq == ULONG_MAX || freq == 0) && errno != 0) {
-                    std::cerr << "WARNING beeps message: invalid freq: " << freqhz << std::endl;
-                    beeps_output(cmdid + " ERROR\n");
+                    d_logger->warn("beeps message: invalid freq: {}", freqhz);
+                    reject_command(cmdid, REJECT_INVALID);
+                    return;
+                }
+                const int chan = channel_for_freq(freq);
+                if(chan < 0) {
+                    d_logger->warn("beeps message: no channel for freq: {}", freqhz);
+                    reject_command(cmdid, REJECT_NO_CHANNEL);
                     return;
                 }
-                tune_target(freq);
 
-                errno = 0;
-                unsigned long capcode = strtoul(capcodestr.c_str(), 0, 10);
-                if(capcode > UINT32_MAX) {
-                    std::cerr << "WARNING beeps message: invalid capcode str: " << capcodestr << std::endl;
-                    beeps_output(cmdid + " ERROR\n");
+                vector<uint32_t> codes;
+                if(!parse_capcodes(capcodestr, codes)) {
+                    d_logger->warn("beeps message: invalid capcode str: {}", capcodestr);
+                    reject_command(cmdid, REJECT_INVALID);
                     return;
                 }
                 msgtype_t msgt;
-                if(msgtype.compare("alpha") == 0) {
-                    msgt = Alpha;
-                } else if(msgtype.compare("numeric") == 0) {
-                    msgt = Numeric;
-                } else {
-                    std::cerr << "WARNING beeps message: invalid type: " << msgtype << std::endl;
-                    beeps_output(cmdid + " ERROR\n");
+                if(!parse_msgtype(msgtype, msgt)) {
+                    d_logger->warn("beeps message: invalid type: {}", msgtype);
+                    reject_command(cmdid, REJECT_INVALID);
                     return;
                 }
                 string realmsg = hex_decode(message);
-                unsigned int baudrate;
-                if(tokens[0].compare("pocsag512") == 0) {
-                    baudrate = 512;
-                } else if(tokens[0].compare("pocsag1200") == 0) {
-                    baudrate = 1200;
-                } else if(tokens[0].compare("pocsag2400") == 0) {
-                    baudrate = 2400;
-                } else {
-                    std::cerr << "WARNING beeps message: invalid baud rate: " << tokens[0] << std::endl;
-                    beeps_output(cmdid + " ERROR\n");
+                MIXALOT_DEBUG(d_logger, "realmsg: {}", realmsg);
+
+                shared_ptr<encode_job> job(new encode_job());
+                job->tokens = tokens;
+                job->chan = chan;
+                job->freq = freq;
+                job->protocol = tokens[0];
+                job->msgtype = msgt;
+                job->codes = codes;
+                job->message = realmsg;
+                if(!prepare_page(*job, 6)) {
                     return;
                 }
-                std::cout << "XXX realmsg: " << realmsg << std::endl;
+                submit_job(job);
+                return;
+            } else if(tokens[0].compare("play") == 0 && tokens.size() >= 5) {
+                play_command(tokens);
+            } else if((tokens[0].compare("sendat") == 0 || tokens[0].compare("sendin") == 0) && tokens.size() >= 4) {
+                schedule_command(tokens);
+            } else if(tokens[0].compare("cancel") == 0 && tokens.size() >= 2) {
+                cancel_command(tokens[1]);
+            }
+        }
 
-                queue_pocsag_batch(msgt, baudrate, capcode, realmsg);
-                
-                add_command_id(cmdid);
+        /**
+         * sendat <unix_time> <command>
+         * sendin <seconds> <command>
+         *
+         * Run a page command (flex, pocsag* or play) later: at a wall clock
+         * time, in seconds since the epoch, or a number of seconds from now.
+         * Times may be fractional; a time that has already passed runs
+         * right away.  The command goes into d_scheduled and is run by
+         * d_sched_thread when it's due, exactly as if it had just arrived:
+         * that's when it's admitted, journaled and acked (or turned away,
+         * with its own tag).  Commands that fall due on the same tick are
+         * submitted back to back, so they're encoded together and grouped
+         * by frequency like any other burst.
+         */
+        void
+        flexencode_impl::schedule_command(const vector<string> &tokens) {
+            vector<string> cmd(tokens.begin() + 2, tokens.end());
+            const string &cmdid = cmd[1];
+            if(cmd[0] != "flex" && cmd[0] != "pocsag512" && cmd[0] != "pocsag1200"
+                    && cmd[0] != "pocsag2400" && cmd[0] != "play") {
+                d_logger->warn("beeps message: can't schedule command: {}", cmd[0]);
+                reject_command(cmdid, REJECT_INVALID);
+                return;
+            }
+            char *end;
+            errno = 0;
+            const double when = strtod(tokens[1].c_str(), &end);
+            if(errno != 0 || *end != '\0' || end == tokens[1].c_str() || !std::isfinite(when)
+                    || (tokens[0] == "sendin" && when < 0)) {
+                d_logger->warn("beeps message: invalid time: {}", tokens[1]);
+                reject_command(cmdid, REJECT_INVALID);
                 return;
             }
+            const auto now = d_clock();
+            std::chrono::duration<double> delay(when);
+            if(tokens[0] == "sendat") {
+                delay -= std::chrono::system_clock::now().time_since_epoch();
+            }
+            const auto deadline = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::max(delay, std::chrono::duration<double>(0)));
+            // Round up, so it never goes out early.
+            const uint64_t tick = (deadline - d_sched_epoch + SCHED_TICK - std::chrono::nanoseconds(1)) / SCHED_TICK;
+            {
+                std::lock_guard<std::mutex> lock(d_sched_mutex);
+                if(d_scheduled.empty()) {
+                    // An empty wheel isn't advanced; catch it up first so
+                    // the new timer isn't placed relative to a stale tick.
+                    vector<vector<string>> none;
+                    d_scheduled.advance((now - d_sched_epoch) / SCHED_TICK, none);
+                }
+                d_scheduled.insert(tick, std::move(cmd));
+            }
+            d_sched_cond.notify_all();
         }
 
-        // Insert bits into the queue.  Here is also where we repeat a single bit
-        // so that we're emitting d_symrate symbols per second.
-        inline void 
-        flexencode_impl::queuebit(bool bit) {
-            const unsigned int interp = d_symrate / d_baudrate;
-            for(unsigned int i = 0; i < interp; i++) {
-                d_bitqueue.push(bit);
+        /**
+         * play <messagetag> <frequency_hz> <protocol> <filename> [ttl=<seconds>]
+         *
+         * Queue a pre-rendered play file (as written by pagerenc -f play)
+         * from the playback directory.  Its header has to match its length
+         * and the protocol's baud rate.  Nothing is encoded: the bits are
+         * expanded in work(), from memory or (for a large file) straight
+         * from a mapping of it.
+         */
+        void
+        flexencode_impl::play_command(const vector<string> &tokens) {
+            const string &cmdid = tokens[1];
+            const string &freqhz = tokens[2];
+            const string &protocol = tokens[3];
+            const string &filename = tokens[4];
+            if(!admit_command(cmdid)) {
+                return;
             }
+            if(d_playback_dir.empty()) {
+                d_logger->warn("beeps message: playback is disabled (no playback_dir)");
+                reject_command(cmdid, REJECT_INVALID);
+                return;
+            }
+            // Only plain relative paths inside the playback directory.
+            if(filename[0] == '/' || filename.find("..") != string::npos) {
+                d_logger->warn("beeps message: invalid playback file: {}", filename);
+                reject_command(cmdid, REJECT_INVALID);
+                return;
+            }
+            core::protocol_t proto;
+            if(!core::parse_protocol(protocol, proto) || d_symrate % core::protocol_baudrate(proto) != 0) {
+                d_logger->warn("beeps message: invalid protocol: {}", protocol);
+                reject_command(cmdid, REJECT_INVALID);
+                return;
+            }
+            errno = 0;
+            unsigned long freq = strtoul(freqhz.c_str(), 0, 10);
+            if((freq == ULONG_MAX || freq == 0) && errno != 0) {
+                d_logger->warn("beeps message: invalid freq: {}", freqhz);
+                reject_command(cmdid, REJECT_INVALID);
+                return;
+            }
+            const int chan = channel_for_freq(freq);
+            if(chan < 0) {
+                d_logger->warn("beeps message: no channel for freq: {}", freqhz);
+                reject_command(cmdid, REJECT_NO_CHANNEL);
+                return;
+            }
+            transmission::sptr tx;
+            try {
+                tx = transmission::from_file(d_playback_dir + "/" + filename, core::protocol_baudrate(proto));
+            } catch(std::exception &exc) {
+                d_logger->warn("beeps message: can't play {}", exc.what());
+                reject_command(cmdid, REJECT_INVALID);
+                return;
+            }
+            // Nothing to encode, but it still has to wait its turn.
+            shared_ptr<encode_job> job(new encode_job());
+            job->tokens = tokens;
+            job->chan = chan;
+            job->freq = freq;
+            job->tx = tx;
+            if(!prepare_page(*job, 5)) {
+                return;
+            }
+            submit_job(job);
         }
 
         flexencode_impl::~flexencode_impl()
         {
+            stop();
+        }
+
+        bool
+        flexencode_impl::start() {
+            {
+                std::lock_guard<std::mutex> lock(d_jobs_mutex);
+                if(d_encode_threads > 0 && !d_workers_running) {
+                    d_workers_stop = false;
+                    for(unsigned int i = 0; i < d_encode_threads; i++) {
+                        d_workers.push_back(std::thread(&flexencode_impl::worker_loop, this));
+                    }
+                    d_workers_running = true;
+                }
+            }
+            if(d_journal) {
+                replay_journal();
+            }
+            if(d_stats_interval > 0 && !d_stats_thread.joinable()) {
+                d_stats_stop = false;
+                d_stats_thread = std::thread(&flexencode_impl::stats_loop, this);
+            }
+            if(!d_sched_thread.joinable()) {
+                d_sched_stop = false;
+                d_sched_thread = std::thread(&flexencode_impl::scheduler_loop, this);
+            }
+            return sync_block::start();
+        }
+
+        bool
+        flexencode_impl::stop() {
+            // Scheduled commands that aren't due yet stay in d_scheduled
+            // until the next start().
+            if(d_sched_thread.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(d_sched_mutex);
+                    d_sched_stop = true;
+                }
+                d_sched_cond.notify_all();
+                d_sched_thread.join();
+            }
+            // Let the encoder threads finish what's been submitted, then run
+            // anything that comes in later inline.
+            {
+                std::lock_guard<std::mutex> lock(d_jobs_mutex);
+                d_workers_stop = true;
+                d_workers_running = false;
+            }
+            d_jobs_cond.notify_all();
+            for(auto &worker : d_workers) {
+                worker.join();
+            }
+            d_workers.clear();
+            if(d_stats_thread.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(d_stats_mutex);
+                    d_stats_stop = true;
+                }
+                d_stats_cond.notify_all();
+                d_stats_thread.join();
+            }
+            return sync_block::stop();
+        }
+
+        // Publish stats() as a PDU every d_stats_interval seconds until stop().
+        void
+        flexencode_impl::stats_loop() {
+            const auto interval = std::chrono::duration<double>(d_stats_interval);
+            std::unique_lock<std::mutex> lock(d_stats_mutex);
+            while(!d_stats_cond.wait_for(lock, interval, [this] { return d_stats_stop; })) {
+                lock.unlock();
+                message_port_pub(pmt::mp("stats"), pmt::cons(stats(), pmt::make_u8vector(0, 0)));
+                lock.lock();
+            }
+        }
+
+        // Run scheduled commands as they fall due, until stop().  Sleeps
+        // until the wheel's next tick with anything in it, and for good
+        // while it's empty; scheduling a command wakes it to look again.
+        void
+        flexencode_impl::scheduler_loop() {
+            std::unique_lock<std::mutex> lock(d_sched_mutex);
+            while(!d_sched_stop) {
+                if(d_scheduled.empty()) {
+                    d_sched_cond.wait(lock);
+                    continue;
+                }
+                d_sched_cond.wait_until(lock, d_sched_epoch + d_scheduled.next_tick() * SCHED_TICK);
+                if(d_sched_stop) {
+                    break;
+                }
+                run_due(lock);
+            }
+        }
+
+        // Advance d_scheduled to the current tick and run the commands that
+        // fell due.  lock holds d_sched_mutex; it's released while they run.
+        void
+        flexencode_impl::run_due(std::unique_lock<std::mutex> &lock) {
+            vector<vector<string>> due;
+            d_scheduled.advance((d_clock() - d_sched_epoch) / SCHED_TICK, due);
+            if(due.empty()) {
+                return;
+            }
+            lock.unlock();
+            {
+                std::lock_guard<std::mutex> cmdlock(d_command_mutex);
+                for(const auto &cmd : due) {
+                    run_command(cmd);
+                }
+            }
+            lock.lock();
+        }
+
+        void
+        flexencode_impl::run_scheduled() {
+            std::unique_lock<std::mutex> lock(d_sched_mutex);
+            run_due(lock);
+        }
+
+        void
+        flexencode_impl::set_clock(std::function<std::chrono::steady_clock::time_point()> clock) {
+            std::lock_guard<std::mutex> lock(d_sched_mutex);
+            d_clock = clock;
+            d_sched_epoch = d_clock();
+        }
+
+        long
+        flexencode_impl::pages_accepted() const {
+            return d_pages_accepted.get();
+        }
+
+        long
+        flexencode_impl::pages_rejected() const {
+            uint64_t total = 0;
+            for(int i = 0; i < REJECT_NREASONS; i++) {
+                total += d_rejected[i].get();
+            }
+            return total;
+        }
+
+        long
+        flexencode_impl::codewords_encoded() const {
+            return d_codewords.get();
+        }
+
+        long
+        flexencode_impl::queued_samples() const {
+            unsigned long pages, samples, airtime_samples, bytes;
+            get_queue_depth(pages, samples, airtime_samples, bytes);
+            return samples;
+        }
+
+        double
+        flexencode_impl::queued_airtime() const {
+            unsigned long pages, samples, airtime_samples, bytes;
+            get_queue_depth(pages, samples, airtime_samples, bytes);
+            return (double)airtime_samples / d_symrate;
+        }
+
+        long
+        flexencode_impl::cache_hits() const {
+            return d_cache_hits.get();
+        }
+
+        long
+        flexencode_impl::cache_misses() const {
+            return d_cache_misses.get();
+        }
+
+        long
+        flexencode_impl::idle_work_calls() const {
+            return d_idle_work_calls.get();
+        }
+
+        static pmt::pmt_t
+        histogram_pmt(const perf_histogram &hist) {
+            const std::vector<uint64_t> buckets = hist.get();
+            return pmt::init_u64vector(buckets.size(), buckets.data());
         }
 
-        // Move data from our internal queue (d_bitqueue) out to gnuradio.  Here 
+        /**
+         * All counters as a dictionary.  Histogram values are u64vectors of
+         * power-of-two buckets (see perf_histogram).
+         */
+        pmt::pmt_t
+        flexencode_impl::stats() const {
+            unsigned long pages, samples, airtime_samples, bytes;
+            get_queue_depth(pages, samples, airtime_samples, bytes);
+
+            pmt::pmt_t d = pmt::make_dict();
+            d = pmt::dict_add(d, pmt::mp("pages_accepted"), pmt::from_uint64(d_pages_accepted.get()));
+            d = pmt::dict_add(d, pmt::mp("rejected_busy"), pmt::from_uint64(d_rejected[REJECT_BUSY].get()));
+            d = pmt::dict_add(d, pmt::mp("rejected_invalid"), pmt::from_uint64(d_rejected[REJECT_INVALID].get()));
+            d = pmt::dict_add(d, pmt::mp("rejected_no_channel"), pmt::from_uint64(d_rejected[REJECT_NO_CHANNEL].get()));
+            d = pmt::dict_add(d, pmt::mp("rejected_encode"), pmt::from_uint64(d_rejected[REJECT_ENCODE].get()));
+            d = pmt::dict_add(d, pmt::mp("rejected_journal"), pmt::from_uint64(d_rejected[REJECT_JOURNAL].get()));
+            d = pmt::dict_add(d, pmt::mp("rejected_duplicate"), pmt::from_uint64(d_rejected[REJECT_DUPLICATE].get()));
+            d = pmt::dict_add(d, pmt::mp("pages_expired"), pmt::from_uint64(d_dropped[DROP_EXPIRED].get()));
+            d = pmt::dict_add(d, pmt::mp("pages_cancelled"), pmt::from_uint64(d_dropped[DROP_CANCELLED].get()));
+            d = pmt::dict_add(d, pmt::mp("codewords_encoded"), pmt::from_uint64(d_codewords.get()));
+            d = pmt::dict_add(d, pmt::mp("queued_pages"), pmt::from_uint64(pages));
+            d = pmt::dict_add(d, pmt::mp("queued_samples"), pmt::from_uint64(samples));
+            d = pmt::dict_add(d, pmt::mp("queued_airtime"), pmt::from_double((double)airtime_samples / d_symrate));
+            d = pmt::dict_add(d, pmt::mp("work_calls"), pmt::from_uint64(d_work_calls.get()));
+            d = pmt::dict_add(d, pmt::mp("idle_work_calls"), pmt::from_uint64(d_idle_work_calls.get()));
+            d = pmt::dict_add(d, pmt::mp("cache_hits"), pmt::from_uint64(d_cache_hits.get()));
+            d = pmt::dict_add(d, pmt::mp("cache_misses"), pmt::from_uint64(d_cache_misses.get()));
+            d = pmt::dict_add(d, pmt::mp("auto_numeric"), pmt::from_uint64(d_auto_numeric.get()));
+            d = pmt::dict_add(d, pmt::mp("airtime_saved"), pmt::from_double(d_auto_saved_us.get() / 1e6));
+            {
+                std::lock_guard<std::mutex> lock(d_sched_mutex);
+                d = pmt::dict_add(d, pmt::mp("scheduled_pages"), pmt::from_uint64(d_scheduled.size()));
+            }
+            if(d_journal) {
+                d = pmt::dict_add(d, pmt::mp("journal_pending"), pmt::from_uint64(d_journal->pending()));
+                d = pmt::dict_add(d, pmt::mp("journal_bytes"), pmt::from_uint64(d_journal->bytes()));
+                d = pmt::dict_add(d, pmt::mp("journal_records"), pmt::from_uint64(d_journal->records()));
+                d = pmt::dict_add(d, pmt::mp("journal_syncs"), pmt::from_uint64(d_journal->syncs()));
+            }
+            d = pmt::dict_add(d, pmt::mp("encode_us_hist"), histogram_pmt(d_encode_us));
+            d = pmt::dict_add(d, pmt::mp("work_items_hist"), histogram_pmt(d_work_items));
+            d = pmt::dict_add(d, pmt::mp("ack_latency_ms_hist"), histogram_pmt(d_ack_latency_ms));
+            return d;
+        }
+
+        bool
+        flexencode_impl::dump_trace(const std::string &filename) const {
+            return d_trace.enabled() && d_trace.dump(filename);
+        }
+
+        void
+        flexencode_impl::setup_rpc() {
+#ifdef GR_CTRLPORT
+            add_rpc_variable(rpcbasic_sptr(new rpcbasic_register_get<flexencode, long>(
+                alias(), "pages_accepted", &flexencode::pages_accepted,
+                pmt::mp(0L), pmt::mp(1000000L), pmt::mp(0L),
+                "pages", "Pages queued for transmission", RPC_PRIVLVL_MIN, DISPTIME | DISPOPTSTRIP)));
+            add_rpc_variable(rpcbasic_sptr(new rpcbasic_register_get<flexencode, long>(
+                alias(), "pages_rejected", &flexencode::pages_rejected,
+                pmt::mp(0L), pmt::mp(1000000L), pmt::mp(0L),
+                "pages", "Commands turned away (busy, invalid, no channel, encode error, journal error)", RPC_PRIVLVL_MIN, DISPTIME | DISPOPTSTRIP)));
+            add_rpc_variable(rpcbasic_sptr(new rpcbasic_register_get<flexencode, long>(
+                alias(), "codewords_encoded", &flexencode::codewords_encoded,
+                pmt::mp(0L), pmt::mp(100000000L), pmt::mp(0L),
+                "words", "32-bit codewords encoded", RPC_PRIVLVL_MIN, DISPTIME | DISPOPTSTRIP)));
+            add_rpc_variable(rpcbasic_sptr(new rpcbasic_register_get<flexencode, long>(
+                alias(), "queued_samples", &flexencode::queued_samples,
+                pmt::mp(0L), pmt::mp(100000000L), pmt::mp(0L),
+                "samples", "Symbols waiting in the queues", RPC_PRIVLVL_MIN, DISPTIME | DISPOPTSTRIP)));
+            add_rpc_variable(rpcbasic_sptr(new rpcbasic_register_get<flexencode, double>(
+                alias(), "queued_airtime", &flexencode::queued_airtime,
+                pmt::mp(0.0), pmt::mp(3600.0), pmt::mp(0.0),
+                "s", "Airtime of the longest channel queue", RPC_PRIVLVL_MIN, DISPTIME | DISPOPTSTRIP)));
+            add_rpc_variable(rpcbasic_sptr(new rpcbasic_register_get<flexencode, long>(
+                alias(), "idle_work_calls", &flexencode::idle_work_calls,
+                pmt::mp(0L), pmt::mp(100000000L), pmt::mp(0L),
+                "calls", "work() calls with nothing to send", RPC_PRIVLVL_MIN, DISPTIME | DISPOPTSTRIP)));
+            add_rpc_variable(rpcbasic_sptr(new rpcbasic_register_get<flexencode, long>(
+                alias(), "cache_hits", &flexencode::cache_hits,
+                pmt::mp(0L), pmt::mp(1000000L), pmt::mp(0L),
+                "pages", "Pages sent from the transmission cache", RPC_PRIVLVL_MIN, DISPTIME | DISPOPTSTRIP)));
+            add_rpc_variable(rpcbasic_sptr(new rpcbasic_register_get<flexencode, long>(
+                alias(), "cache_misses", &flexencode::cache_misses,
+                pmt::mp(0L), pmt::mp(1000000L), pmt::mp(0L),
+                "pages", "Pages encoded (not in the transmission cache)", RPC_PRIVLVL_MIN, DISPTIME | DISPOPTSTRIP)));
+#endif
+        }
+
+        // Move data from our internal queues (one per channel) out to gnuradio.  Here 
         // we also convert our data from bits (0 and 1) to symbols (1 and -1).  
         //
         // These symbols are then used by the FM block to generate signals that are
         // +/- the max deviation.  (For POCSAG, that deviation is 4500 Hz.)  All of
         // that is taken care of outside this block; we just emit -1 and 1.
+        //
+        // With more than one channel, every output has to produce the same number
+        // of items; channels that run out of data before the busiest one are
+        // padded with 0 (no deviation), which downstream can use to key the
+        // carrier off.
 
         int
         flexencode_impl::work(int noutput_items,
                   gr_vector_const_void_star &input_items,
                   gr_vector_void_star &output_items) {
             //const float *in = (const float *) input_items[0];
-            unsigned char *out = (unsigned char *) output_items[0];
 
             boost::mutex::scoped_lock lock(bitqueue_mutex);
-
-            if(d_bitqueue.empty()) {
-                clear_cmdid_queue();
-                return 0;
-            }
-            const int toxfer = noutput_items < d_bitqueue.size() ? noutput_items : d_bitqueue.size();
-            assert(toxfer >= 0);
-            for(int i = 0; i < toxfer ; i++) {
-                const bool bbit = d_bitqueue.front();
-                switch((int)bbit) {
-                    case 0:
-                        out[i] = -1;
-                        break;
-                    case 1:
-                        out[i] = 1;
-                        break;
-                    default:
-                        std::cout << "invalid value in bitqueue" << std::endl;
-                        abort();
+            d_work_calls.add();
+
+            vector<int> chanproduced(d_chans.size(), 0);
+            int maxproduced = 0;
+            for(size_t chan = 0; chan < d_chans.size(); chan++) {
+                unsigned char *out = (unsigned char *) output_items[chan];
+                channel_state &cs = d_chans[chan];
+                int produced = 0;
+                while(produced < noutput_items) {
+                    if(!cs.current && !start_next_page(chan, produced)) {
                         break;
+                    }
+                    // Expand the packed bits: each one is repeated sps times.
+                    const transmission &tx = *cs.current;
+                    const unsigned long sps = d_symrate / tx.baudrate();
+                    const unsigned long total = tx_samples(tx);
+                    const size_t ret = tx.render(sps, cs.current_pos, out + produced, noutput_items - produced);
+                    produced += ret;
+                    cs.current_pos += ret;
+                    if(cs.current_pos == total) {
+                        ack_page(cs.current_seq);
+                        cs.current.reset();
+                        cs.current_pos = 0;
+                    }
                 }
-                d_bitqueue.pop();
+                chanproduced[chan] = produced;
+                maxproduced = std::max(maxproduced, produced);
+            }
+            if(maxproduced == 0) {
+                d_idle_work_calls.add();
+                return 0;
+            }
+            d_work_items.add(maxproduced);
+            d_trace.record(TRACE_WORK, 0, maxproduced);
+            for(size_t chan = 0; chan < d_chans.size(); chan++) {
+                unsigned char *out = (unsigned char *) output_items[chan];
+                memset(out + chanproduced[chan], 0, maxproduced - chanproduced[chan]);
             }
-            return toxfer;
+            return maxproduced;
 
         }
     } /* namespace mixalot */
@@ -8,11 +8,24 @@
 #define INCLUDED_MIXALOT_FLEXENCODE_IMPL_H
 
 #include <gnuradio/mixalot/flexencode.h>
-#include <queue>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
-#include <itpp/comm/bch.h>
+#include "page_journal.h"
+#include "perf_counters.h"
+#include "recent_set.h"
+#include "timer_wheel.h"
+#include "trace_ring.h"
+#include "transmission.h"
 
-using namespace itpp;
 using std::string;
 using std::vector;
 using std::shared_ptr;
@@ -21,38 +34,207 @@ using std::shared_ptr;
 namespace gr {
   namespace mixalot {
 
+    // An encoded page waiting for its turn on the air.
+    struct pending_page {
+        uint64_t seq;                   // arrival order
+        double freq;                    // transmit frequency (Hz)
+        transmission::sptr tx;          // encoded page
+        uint64_t journal_id;            // id in d_journal (0 = not journaled)
+        string cmdid;                   // tag, for "cancel" and the response if it's dropped
+        std::chrono::steady_clock::time_point expires;  // dropped if not on the air by then
+        uint64_t dedup_key;             // key in d_recent (0 = none)
+    };
+
+    // A command that has been queued and is waiting for its ack.
+    struct pending_ack {
+        string cmdid;
+        std::chrono::steady_clock::time_point accepted;
+        uint64_t journal_id;            // id in d_journal (0 = not journaled)
+        uint64_t seq;                   // pending_page::seq
+    };
+
+    // Why a command was turned away; indexes flexencode_impl::d_rejected.
+    enum reject_reason {
+        REJECT_BUSY = 0,        // admission limit reached
+        REJECT_INVALID,         // malformed command
+        REJECT_NO_CHANNEL,      // frequency not in the channel map
+        REJECT_ENCODE,          // encoder failed
+        REJECT_JOURNAL,         // couldn't write the page to the journal
+        REJECT_DUPLICATE,       // same page as one sent within the duplicate window
+        REJECT_NREASONS
+    };
+
+    // Why an accepted page was dropped before it went on the air; indexes
+    // flexencode_impl::d_dropped.
+    enum drop_reason {
+        DROP_EXPIRED = 0,       // its TTL ran out
+        DROP_CANCELLED,         // "cancel <tag>"
+        DROP_NREASONS
+    };
+
+    // A page command on its way from beeps_message() to the output queue.
+    struct encode_job {
+        uint64_t seq;                   // arrival order; jobs are committed in this order
+        vector<string> tokens;          // the command, for the journal and the ack
+        int chan;
+        double freq;
+        string protocol;                // "flex" or "pocsagNNN" (empty when tx is given, as for "play")
+        flexencode::msgtype_t msgtype;
+        vector<uint32_t> codes;
+        string message;                 // decoded message text
+        uint64_t replay_id;             // journal id when replaying the journal (0 = new page)
+        std::chrono::steady_clock::time_point expires;  // dropped if not on the air by then
+        uint64_t dedup_key;             // key in d_recent (0 = none)
+        transmission::sptr tx;          // the encoded page; empty if encoding failed
+        bool encoded;                   // run_job() is done with it (under d_commit_mutex)
+        std::atomic<bool> cancelled;    // dropped by "cancel" before it was committed
+    };
+
+    // Output state for one channel (one output port).
+    struct channel_state {
+        transmission::sptr current;         // Page being sent (empty when idle)
+        uint64_t current_seq;               // pending_page::seq of current
+        unsigned long current_pos;          // Output samples of current already sent
+        std::list<pending_page> pending;    // Encoded pages not yet started, in arrival order
+        unsigned long pending_samples;      // Total output samples of the pages in pending
+        unsigned long pending_bytes;        // Memory held by the pages in pending
+        uint64_t group_cutoff;              // Pages at curfreq older than this belong to the current group
+        double curfreq;                     // Frequency the transmitter is tuned to (0 = not yet tuned)
+    };
+
     class flexencode_impl : public flexencode
     {
     private:
-        std::queue<bool> d_bitqueue;   // Queue of symbols to be sent out.
-        std::vector<string> d_cmdlist;     // List of command IDs to ack
-        unsigned int d_baudrate;            // baud rate to transmit at
+        std::vector<channel_state> d_chans; // One per output port
+        std::vector<double> d_channel_freqs;    // Channel map; empty for single-output (retuning) mode
+        transmission_cache d_cache;         // Recently encoded pages
+        std::mutex d_cache_mutex;           // guards d_cache
+        std::string d_playback_dir;         // Directory "play" may read from (empty = disabled)
+        std::unique_ptr<page_journal> d_journal;    // Accepted pages, for crash recovery (empty = none)
+        uint64_t d_replay_id;               // Journal id of the page being replayed (0 = none)
+        uint64_t d_next_seq;                // Sequence number for the next accepted page
+        std::vector<pending_ack> d_cmdlist;    // List of command IDs to ack
         unsigned long d_symrate;            // output symbol rate (must be evenly divisible by the baud rate)
+        double d_max_queue_seconds;         // admission limit: queued airtime (0 = unlimited)
+        unsigned int d_max_queue_pages;     // admission limit: pages not yet acked (0 = unlimited)
+        unsigned long d_max_queue_bytes;    // admission limit: symbol queue memory (0 = unlimited)
+
+        perf_counter d_pages_accepted;      // pages queued for transmission
+        perf_counter d_rejected[REJECT_NREASONS];   // commands turned away, by reason
+        perf_counter d_codewords;           // 32-bit words encoded (including sync and idle)
+        perf_counter d_work_calls;          // calls to work()
+        perf_counter d_idle_work_calls;     // calls to work() that produced nothing
+        perf_counter d_cache_hits;          // pages found in d_cache
+        perf_counter d_cache_misses;        // pages that had to be encoded
+        perf_counter d_auto_numeric;        // "auto" pages encoded as numeric
+        perf_counter d_auto_saved_us;       // airtime those saved over alpha, microseconds
+        perf_counter d_dropped[DROP_NREASONS];  // accepted pages that never went out, by reason
+        perf_histogram d_encode_us;         // time to encode one page, microseconds
+        perf_histogram d_work_items;        // items produced per non-idle work() call
+        perf_histogram d_ack_latency_ms;    // time from queueing a page to its ack, milliseconds
+        trace_ring d_trace;                 // binary event trace for post-mortem analysis
+
+        double d_stats_interval;            // seconds between stats PDUs (0 = never)
+        std::thread d_stats_thread;         // publishes stats PDUs
+        std::mutex d_stats_mutex;
+        std::condition_variable d_stats_cond;
+        bool d_stats_stop;                  // tells d_stats_thread to exit
+
+        unsigned int d_encode_threads;      // encoder threads (0 = encode on the message thread)
+        std::vector<std::thread> d_workers; // encode jobs from d_jobs
+        std::deque<shared_ptr<encode_job>> d_jobs;  // jobs waiting for a worker
+        std::mutex d_jobs_mutex;            // guards d_jobs, d_workers_running, d_workers_stop
+        std::condition_variable d_jobs_cond;
+        bool d_workers_running;             // jobs go to d_jobs (otherwise they run inline)
+        bool d_workers_stop;                // tells the workers to exit once d_jobs is empty
+        uint64_t d_next_job;                // seq for the next job (under d_command_mutex)
+        std::map<uint64_t, shared_ptr<encode_job>> d_uncommitted;  // submitted jobs not yet committed, by seq
+        std::mutex d_commit_mutex;          // guards d_uncommitted
+        std::atomic<unsigned long> d_jobs_inflight; // jobs submitted but not yet committed
 
-        inline void queuebit(bool bit);
+        std::mutex d_command_mutex;         // runs commands one at a time (beeps_message(), scheduler, replay)
+        std::function<std::chrono::steady_clock::time_point()> d_clock;    // time for TTLs, acks and the scheduler
+        std::function<void(const string &)> d_output_hook; // also gets each beeps_output message (tests only)
+        timer_wheel<vector<string>> d_scheduled;    // "sendat"/"sendin" commands not yet due, by tick
+        std::chrono::steady_clock::time_point d_sched_epoch;   // tick 0 of d_scheduled
+        std::thread d_sched_thread;         // runs d_scheduled commands as they fall due
+        mutable std::mutex d_sched_mutex;   // guards d_scheduled, d_sched_stop
+        std::condition_variable d_sched_cond;
+        bool d_sched_stop;                  // tells d_sched_thread to exit
+
+        double d_page_ttl;                  // default seconds a page may wait to go out (0 = forever)
+        double d_dedup_window;              // seconds a page counts as a duplicate of an earlier one (0 = never)
+        recent_set d_recent;                // keys of pages submitted within d_dedup_window
+        std::mutex d_recent_mutex;          // guards d_recent
+        bool d_retune_messages;             // also send retunes on cmds_out (not sample-aligned)
+
+        void get_queue_depth(unsigned long &pages, unsigned long &samples, unsigned long &airtime_samples, unsigned long &bytes) const;
+        void report_queue_depth(unsigned long pages, unsigned long airtime_samples, unsigned long bytes);
+        bool admit_command(string const &cmdid);
+        void reject_command(string const &cmdid, reject_reason reason);
+        void record_encode_time(std::chrono::steady_clock::time_point start);
+        void stats_loop();
+        int channel_for_freq(double freq);
+        transmission::sptr cache_lookup(const string &key);
+        void submit_job(shared_ptr<encode_job> job);
+        void run_job(encode_job &job);
+        void commit_job(shared_ptr<encode_job> job);
+        void worker_loop();
+        unsigned long tx_samples(const transmission &tx) const { return tx.nbits() * (d_symrate / tx.baudrate()); }
+        void commit_page(const encode_job &job, uint64_t journal_id);
+        bool prepare_page(encode_job &job, size_t optarg);
+        void forget_page(uint64_t dedup_key);
+        void drop_job(const encode_job &job, drop_reason reason);
+        void drop_page(int chan, std::list<pending_page>::iterator page, drop_reason reason);
+        void cancel_command(const string &cmdid);
+        bool accept_page(const encode_job &job);
+        void replay_journal();
+        void run_command(const vector<string> &tokens);
+        void play_command(const vector<string> &tokens);
+        void schedule_command(const vector<string> &tokens);
+        void scheduler_loop();
+        void run_due(std::unique_lock<std::mutex> &lock);
+        bool start_next_page(int chan, int offset);
 
     public:
-      flexencode_impl();
+      flexencode_impl(double max_queue_seconds, unsigned int max_queue_pages, unsigned long max_queue_bytes, const std::vector<double> &channel_freqs, double stats_interval, unsigned int trace_depth, const std::string &playback_dir, unsigned long cache_bytes, const std::string &journal_path, unsigned int encode_threads, double page_ttl, double dedup_window, bool retune_messages);
       ~flexencode_impl();
 
-        void clear_cmdid_queue();
-        void add_command_id(std::string cmdid);
-        bool queue_pocsag_batch(msgtype_t msgtype, unsigned int baudrate, unsigned int capcode, std::string message);
-        bool queue_flex_batch(const msgtype_t msgtype, const vector<uint32_t> &codes, const char *msgbody);
-        boost::mutex bitqueue_mutex;
-        boost::mutex cmdlist_mutex;
+        bool start() override;
+        bool stop() override;
+        void setup_rpc() override;
+
+        long pages_accepted() const override;
+        long pages_rejected() const override;
+        long codewords_encoded() const override;
+        long queued_samples() const override;
+        double queued_airtime() const override;
+        long idle_work_calls() const override;
+        long cache_hits() const override;
+        long cache_misses() const override;
+        pmt::pmt_t stats() const override;
+        bool dump_trace(const std::string &filename) const override;
+
+        // For tests: read the time from clock instead of the steady clock.
+        // Call it before queueing anything.  The scheduler thread sleeps on
+        // the real clock, so don't start() it; call run_scheduled() after
+        // moving the clock on.
+        void set_clock(std::function<std::chrono::steady_clock::time_point()> clock);
+        void run_scheduled();
+        // For tests: also hand each message sent on beeps_output to hook,
+        // since there's no flowgraph to deliver it.
+        void set_output_hook(std::function<void(const string &)> hook) { d_output_hook = hook; }
+
+        void ack_page(uint64_t seq);
+        void send_ack(const pending_ack &ack, std::chrono::steady_clock::time_point now);
+        void add_command_id(std::string cmdid, uint64_t journal_id, uint64_t seq);
+        mutable boost::mutex bitqueue_mutex;
+        mutable boost::mutex cmdlist_mutex;
 
         void tune_target(double freqhz);
-        bool make_standard_numeric_msg(unsigned int nwords, unsigned int message_start, const string msg, vector<uint32_t> &vecwords, vector<uint32_t> &msgwords, uint32_t &checksum);
-        bool make_alphanumeric_msg(unsigned int num_address_words, unsigned int message_start, const string msg, vector<uint32_t> &vecwords, vector<uint32_t> &msgwords);
         void beeps_message(pmt::pmt_t msg);
 		void beeps_output(string const &msgtext);
 
-        void queue_pocsag(shared_ptr<bvec> bvptr);
-        void queue_pocsag(uint32_t val);
-        void queue(shared_ptr<bvec> bvptr);
-        void queue(uint8_t *arr, size_t sz);
-        void queue(uint32_t val);
         int work(int noutput_items,
            gr_vector_const_void_star &input_items,
            gr_vector_void_star &output_items);
@@ -0,0 +1,39 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cmath>
+#include <vector>
+#include "fsk_nco.h"
+
+namespace gr {
+    namespace mixalot {
+        const gr_complex *
+        nco_table() {
+            static const std::vector<gr_complex> table = [] {
+                const unsigned int size = 1 << NCO_TABLE_BITS;
+                std::vector<gr_complex> t(size);
+                for(unsigned int i = 0; i < size; i++) {
+                    // Sample the middle of each phase bin rather than its start,
+                    // so truncating the phase doesn't add a constant offset.
+                    const double theta = 2.0 * M_PI * (i + 0.5) / size;
+                    t[i] = gr_complex(cos(theta), sin(theta));
+                }
+                return t;
+            }();
+            return table.data();
+        }
+
+        int32_t
+        nco_phase_increment(double freqhz, double samp_rate) {
+            const double cycles = freqhz / samp_rate;
+            return (int32_t)(int64_t)llround(cycles * 4294967296.0);
+        }
+    }
+}
@@ -0,0 +1,33 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_FSK_NCO_H
+#define INCLUDED_MIXALOT_FSK_NCO_H
+
+#include <gnuradio/types.h>
+#include <stdint.h>
+
+namespace gr {
+    namespace mixalot {
+        // Table-driven oscillator shared by the FSK modulators.  Phase is a
+        // 32-bit fixed-point fraction of a full cycle, so it wraps for free
+        // and stays continuous across symbols and work() calls.
+        static const unsigned int NCO_TABLE_BITS = 12;
+
+        // Returns the 2^NCO_TABLE_BITS-entry table of exp(j*2*pi*n/size).
+        const gr_complex *nco_table();
+
+        // Phase increment per sample for a tone at freqhz, sampled at samp_rate.
+        int32_t nco_phase_increment(double freqhz, double samp_rate);
+
+        static inline gr_complex
+        nco_lookup(const gr_complex *table, uint32_t phase) {
+            return table[phase >> (32 - NCO_TABLE_BITS)];
+        }
+    }
+}
+
+#endif /* INCLUDED_MIXALOT_FSK_NCO_H */
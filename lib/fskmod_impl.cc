@@ -0,0 +1,156 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gnuradio/io_signature.h>
+#include <cmath>
+#include <stdexcept>
+#include "fskmod_impl.h"
+#include "fsk_nco.h"
+
+namespace gr {
+    namespace mixalot {
+
+        fskmod::sptr
+        fskmod::make(double samp_rate, unsigned int interpolation, double deviation, int shaping, double bt, double baudrate, float amplitude) {
+            return gnuradio::get_initial_sptr (new fskmod_impl(samp_rate, interpolation, deviation, shaping, bt, baudrate, amplitude));
+        }
+
+        /**
+         * Build the frequency shaping filter, sampled at the output rate (sps
+         * output samples per baud).  Taps are normalized to unit sum so the
+         * steady-state deviation is unchanged.  No shaping gives one tap.
+         */
+        void
+        fskmod_impl::design_shaping(int shaping, double bt, double sps, std::vector<double> &taps) {
+            taps.clear();
+            if(shaping == None) {
+                taps.push_back(1.0);
+                return;
+            }
+            if(bt <= 0) {
+                throw std::invalid_argument("fskmod shaping parameter must be positive");
+            }
+            // Gaussian spans 3 symbols, raised cosine 4.
+            const double span = (shaping == Gaussian) ? 3.0 : 4.0;
+            const int half = (int)std::ceil(span * sps / 2);
+            for(int i = -half; i <= half; i++) {
+                const double t = i / sps;      // in symbols
+                double h;
+                if(shaping == Gaussian) {
+                    const double sigma = std::sqrt(std::log(2.0)) / (2.0 * M_PI * bt);
+                    h = std::exp(-(t * t) / (2.0 * sigma * sigma));
+                } else if(shaping == RaisedCosine) {
+                    const double denom = 1.0 - (2.0 * bt * t) * (2.0 * bt * t);
+                    const double sinc = (t == 0) ? 1.0 : std::sin(M_PI * t) / (M_PI * t);
+                    if(std::fabs(denom) < 1e-9) {
+                        h = (M_PI / 4.0) * sinc;
+                    } else {
+                        h = sinc * std::cos(M_PI * bt * t) / denom;
+                    }
+                } else {
+                    throw std::invalid_argument("invalid fskmod shaping type");
+                }
+                taps.push_back(h);
+            }
+            double sum = 0;
+            for(auto it = taps.begin(); it != taps.end(); it++) {
+                sum += *it;
+            }
+            for(auto it = taps.begin(); it != taps.end(); it++) {
+                *it /= sum;
+            }
+        }
+
+        fskmod_impl::fskmod_impl(double samp_rate, unsigned int interpolation, double deviation, int shaping, double bt, double baudrate, float amplitude)
+          : sync_interpolator("fskmod",
+                  io_signature::make(1, 1, sizeof (unsigned char)),
+                  io_signature::make(1, 1, sizeof (gr_complex)),
+                  interpolation),
+          d_interp(interpolation), d_phase(0), d_amplitude(amplitude), d_table(nco_table())
+        {
+            if(interpolation < 1) {
+                throw std::invalid_argument("fskmod interpolation must be at least 1");
+            }
+            if(deviation >= samp_rate / 2) {
+                throw std::invalid_argument("fskmod deviation must be below samp_rate/2");
+            }
+            std::vector<double> shape;
+            design_shaping(shaping, bt, samp_rate / baudrate, shape);
+
+            // The input is held for d_interp output samples, so the frequency
+            // response to one input symbol is the shaping filter convolved with
+            // a d_interp-long rectangle.
+            std::vector<double> held(shape.size() + d_interp - 1, 0.0);
+            for(size_t i = 0; i < shape.size(); i++) {
+                for(unsigned int j = 0; j < d_interp; j++) {
+                    held[i + j] += shape[i];
+                }
+            }
+
+            // Split that into a polyphase table of phase increments: output
+            // sample p of input symbol k gets sum over m of
+            // in[k - m] * d_incr[p * d_ntaps + m].
+            d_ntaps = (held.size() + d_interp - 1) / d_interp;
+            const double incr_scale = nco_phase_increment(deviation, samp_rate);
+            d_incr.assign(d_interp * d_ntaps, 0);
+            for(unsigned int p = 0; p < d_interp; p++) {
+                for(unsigned int m = 0; m < d_ntaps; m++) {
+                    const size_t idx = p + m * d_interp;
+                    if(idx < held.size()) {
+                        d_incr[p * d_ntaps + m] = (int32_t)std::lround(held[idx] * incr_scale);
+                    }
+                }
+            }
+            set_history(d_ntaps);
+        }
+
+        fskmod_impl::~fskmod_impl()
+        {
+        }
+
+        int
+        fskmod_impl::work(int noutput_items,
+                  gr_vector_const_void_star &input_items,
+                  gr_vector_void_star &output_items) {
+            const int8_t *in = (const int8_t *) input_items[0];
+            gr_complex *out = (gr_complex *) output_items[0];
+            const int ninput = noutput_items / d_interp;
+            // Carrier keying follows the symbol at the middle of the filter.
+            const unsigned int center = (d_ntaps - 1) / 2;
+
+            uint32_t phase = d_phase;
+            for(int i = 0; i < ninput; i++) {
+                // cur[0] is the newest symbol, cur[-m] the one m symbols back.
+                const int8_t *cur = &in[i + d_ntaps - 1];
+                const float gain = (cur[-(int)center] == 0) ? 0.0f : d_amplitude;
+                if(d_ntaps == 1) {
+                    const uint32_t incr = (uint32_t)d_incr[0] * (uint32_t)(int32_t)((cur[0] > 0) - (cur[0] < 0));
+                    for(unsigned int p = 0; p < d_interp; p++) {
+                        *out++ = nco_lookup(d_table, phase) * gain;
+                        phase += incr;
+                    }
+                    continue;
+                }
+                for(unsigned int p = 0; p < d_interp; p++) {
+                    const int32_t *row = &d_incr[p * d_ntaps];
+                    uint32_t incr = 0;
+                    for(unsigned int m = 0; m < d_ntaps; m++) {
+                        const int8_t sym = cur[-(int)m];
+                        incr += (uint32_t)row[m] * (uint32_t)(int32_t)((sym > 0) - (sym < 0));
+                    }
+                    *out++ = nco_lookup(d_table, phase) * gain;
+                    phase += incr;
+                }
+            }
+            d_phase = phase;
+            return noutput_items;
+        }
+    } /* namespace mixalot */
+} /* namespace gr */
@@ -0,0 +1,40 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_FSKMOD_IMPL_H
+#define INCLUDED_MIXALOT_FSKMOD_IMPL_H
+
+#include <gnuradio/mixalot/fskmod.h>
+#include <vector>
+
+namespace gr {
+  namespace mixalot {
+
+    class fskmod_impl : public fskmod
+    {
+    private:
+        unsigned int d_interp;
+        unsigned int d_ntaps;               // input symbols that affect each output sample
+        std::vector<int32_t> d_incr;        // phase increment table, d_interp rows of d_ntaps
+        uint32_t d_phase;                   // current NCO phase
+        float d_amplitude;
+        const gr_complex *d_table;
+
+        void design_shaping(int shaping, double bt, double sps, std::vector<double> &taps);
+
+    public:
+      fskmod_impl(double samp_rate, unsigned int interpolation, double deviation, int shaping, double bt, double baudrate, float amplitude);
+      ~fskmod_impl();
+
+        int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+    };
+
+  } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_FSKMOD_IMPL_H */
@@ -0,0 +1,120 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gnuradio/io_signature.h>
+#include <volk/volk.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "fsksynth_impl.h"
+#include "fsk_nco.h"
+
+namespace gr {
+    namespace mixalot {
+
+        fsksynth::sptr
+        fsksynth::make(double samp_rate, unsigned int interpolation, const std::vector<double> &freq_offsets, double deviation) {
+            return gnuradio::get_initial_sptr (new fsksynth_impl(samp_rate, interpolation, freq_offsets, deviation));
+        }
+
+        fsksynth_impl::fsksynth_impl(double samp_rate, unsigned int interpolation, const std::vector<double> &freq_offsets, double deviation)
+          : sync_interpolator("fsksynth",
+                  io_signature::make(std::max<int>(1, freq_offsets.size()), std::max<int>(1, freq_offsets.size()), sizeof (unsigned char)),
+                  io_signature::make(1, 1, sizeof (gr_complex)),
+                  interpolation),
+          d_interp(interpolation), d_table(nco_table())
+        {
+            if(freq_offsets.empty()) {
+                throw std::invalid_argument("fsksynth needs at least one channel");
+            }
+            if(interpolation < 1) {
+                throw std::invalid_argument("fsksynth interpolation must be at least 1");
+            }
+            for(auto it = freq_offsets.begin(); it != freq_offsets.end(); it++) {
+                if(std::fabs(*it) + deviation >= samp_rate / 2) {
+                    throw std::invalid_argument("fsksynth channel offset plus deviation must be below samp_rate/2");
+                }
+                channel chan;
+                chan.incr[0] = nco_phase_increment(*it - deviation, samp_rate);
+                chan.incr[1] = nco_phase_increment(*it, samp_rate);
+                chan.incr[2] = nco_phase_increment(*it + deviation, samp_rate);
+                chan.phase = 0;
+                d_channels.push_back(chan);
+            }
+            d_gain = 1.0f / d_channels.size();
+        }
+
+        fsksynth_impl::~fsksynth_impl()
+        {
+        }
+
+        /**
+         * Generate one channel's samples into out.  Returns false (and leaves
+         * out alone) if the channel has no carrier for this whole chunk; its
+         * phase still advances so it stays continuous.
+         */
+        bool
+        fsksynth_impl::synth_channel(channel &chan, const int8_t *in, int ninput, gr_complex *out) {
+            bool active = false;
+            for(int i = 0; i < ninput; i++) {
+                if(in[i] != 0) {
+                    active = true;
+                    break;
+                }
+            }
+            if(!active) {
+                chan.phase += (uint32_t)chan.incr[1] * (uint32_t)(ninput * d_interp);
+                return false;
+            }
+            uint32_t phase = chan.phase;
+            for(int i = 0; i < ninput; i++) {
+                const int8_t sym = in[i];
+                const int32_t incr = chan.incr[(sym > 0) - (sym < 0) + 1];
+                const float gain = (sym == 0) ? 0.0f : d_gain;
+                for(unsigned int k = 0; k < d_interp; k++) {
+                    *out++ = nco_lookup(d_table, phase) * gain;
+                    phase += incr;
+                }
+            }
+            chan.phase = phase;
+            return true;
+        }
+
+        int
+        fsksynth_impl::work(int noutput_items,
+                  gr_vector_const_void_star &input_items,
+                  gr_vector_void_star &output_items) {
+            gr_complex *out = (gr_complex *) output_items[0];
+            const int ninput = noutput_items / d_interp;
+
+            if(d_scratch.size() < (size_t)noutput_items) {
+                d_scratch.resize(noutput_items);
+            }
+            // The first active channel is written straight to the output; the
+            // rest go through d_scratch and are summed in with VOLK.
+            bool have_output = false;
+            for(size_t c = 0; c < d_channels.size(); c++) {
+                const int8_t *in = (const int8_t *) input_items[c];
+                gr_complex *dest = have_output ? &d_scratch[0] : out;
+                if(!synth_channel(d_channels[c], in, ninput, dest)) {
+                    continue;
+                }
+                if(have_output) {
+                    volk_32f_x2_add_32f((float *)out, (const float *)out, (const float *)dest, 2 * noutput_items);
+                }
+                have_output = true;
+            }
+            if(!have_output) {
+                std::fill(out, out + noutput_items, gr_complex(0, 0));
+            }
+            return noutput_items;
+        }
+    } /* namespace mixalot */
+} /* namespace gr */
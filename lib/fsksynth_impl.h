@@ -0,0 +1,43 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_FSKSYNTH_IMPL_H
+#define INCLUDED_MIXALOT_FSKSYNTH_IMPL_H
+
+#include <gnuradio/mixalot/fsksynth.h>
+#include <vector>
+
+namespace gr {
+  namespace mixalot {
+
+    class fsksynth_impl : public fsksynth
+    {
+    private:
+        struct channel {
+            int32_t incr[3];        // phase increment for symbols -1, 0 and +1
+            uint32_t phase;         // current NCO phase
+        };
+        std::vector<channel> d_channels;
+        unsigned int d_interp;
+        float d_gain;                       // per-channel amplitude
+        std::vector<gr_complex> d_scratch;  // one channel's samples before they're summed in
+        const gr_complex *d_table;
+
+        bool synth_channel(channel &chan, const int8_t *in, int ninput, gr_complex *out);
+
+    public:
+      fsksynth_impl(double samp_rate, unsigned int interpolation, const std::vector<double> &freq_offsets, double deviation);
+      ~fsksynth_impl();
+
+        int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+    };
+
+  } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_FSKSYNTH_IMPL_H */
@@ -48,6 +48,9 @@
 
 /* 12-bit of data gets encoded into 23-bit of something. */
 
+#include <mutex>
+#include "golay.h"
+
 #define X22             0x00400000   /* vector representation of X^{22} */
 #define X11             0x00000800   /* vector representation of X^{11} */
 #define MASK12          0xfffff800   /* auxiliary vector for testing */
@@ -140,8 +143,8 @@ long get_syndrome(long pattern)
 
 
 
-unsigned long calcgolay(unsigned long data) {
-   register int i;
+static void init_tables(void) {
+   int i;
    long temp;
 
    /*
@@ -203,25 +206,34 @@ unsigned long calcgolay(unsigned long data) {
         decoding_table[get_syndrome(temp)] = temp;
         }
 
-   /* ---------------------------------------------------------------------
-    *                        Generate DATA
-    * ---------------------------------------------------------------------
-    */
-    /*
-     * data = 12 information bits, an information polynomial i(x)
-     */
-    //data = random() & 0x00000fff;
-    //printf("data =            %#012lx\n", data);
+}
 
+static std::once_flag tables_once;
+
+unsigned long calcgolay(unsigned long data) {
    /*
     * ---------------------------------------------------------------------
     *                         ENCODING
     * ---------------------------------------------------------------------
     */
-    codeword = encoding_table[data];
-    //printf("codeword =        %#012lx\n", codeword);
-    return codeword;
+    std::call_once(tables_once, init_tables);
+    return encoding_table[data];
 }
 
-
-
+unsigned long golay_decode(unsigned long recd, int *nerrors) {
+   /*
+    * ---------------------------------------------------------------------
+    *                         DECODING
+    *
+    * The syndrome of the received vector indexes the decoding table,
+    * which gives the most likely error pattern.  Since the code is
+    * perfect, every received vector decodes to some codeword.
+    * ---------------------------------------------------------------------
+    */
+    std::call_once(tables_once, init_tables);
+    const long errors = decoding_table[get_syndrome(recd & 0x7fffff)];
+    if (nerrors) {
+        *nerrors = __builtin_popcountl(errors);
+    }
+    return (recd & 0x7fffff) ^ errors;
+}
@@ -1 +1,8 @@
 unsigned long calcgolay(unsigned long data); 
+
+/*
+ * Correct up to 3 errors in a received (23,12) codeword (as returned by
+ * calcgolay) and return the corrected codeword; the data is the upper 12
+ * bits.  If nerrors is non-NULL, it is set to the number of bits corrected.
+ */
+unsigned long golay_decode(unsigned long recd, int *nerrors);
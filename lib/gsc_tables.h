@@ -0,0 +1,40 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_GSC_TABLES_H
+#define INCLUDED_MIXALOT_GSC_TABLES_H
+
+#include <stdint.h>
+
+namespace gr {
+    namespace mixalot {
+
+        // Rep. 900-2, Annex I, Table V
+        static const unsigned int preamble_values[] = {
+            2030, 1628, 3198, 647, 191, 3315, 1949, 2540, 1560, 2335
+        };
+
+        // Golay-coded data for the first address word, indexed by g1g0 (mod 50)
+        static const uint32_t word1s[50] = {
+            721, 2731, 2952, 1387, 1578,
+            1708, 2650, 1747, 2580, 1376,
+            2692, 696, 1667, 3800, 3552,
+            3424, 1384, 3595, 876, 3124,
+            2285, 2608, 899, 3684, 3129,
+            2124, 1287, 2616, 1647, 3216,
+            375, 1232, 2824, 1840, 408,
+            3127, 3387, 882, 3468, 3267,
+            1575, 3463, 3152, 2572, 1252,
+            2592, 1552, 835, 1440, 160
+        };
+
+        // Data for the start code word
+        static const uint32_t gsc_startcode = 713;
+
+    } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_GSC_TABLES_H */
@@ -0,0 +1,23 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_LOGGING_H
+#define INCLUDED_MIXALOT_LOGGING_H
+
+#include <gnuradio/logger.h>
+
+// Per-word/per-block encoder debugging.  This is far too chatty (and too
+// slow) to leave in the encode path, so unless the build is configured with
+// -DENABLE_DEBUG_LOGGING=ON it compiles to nothing, arguments included.
+// When it is compiled in, it goes to the block's logger at debug level, so
+// it can still be switched on and off per block with set_log_level().
+#ifdef MIXALOT_DEBUG_LOGGING
+#define MIXALOT_DEBUG(logger, ...) (logger)->debug(__VA_ARGS__)
+#else
+#define MIXALOT_DEBUG(logger, ...) do { } while(0)
+#endif
+
+#endif /* INCLUDED_MIXALOT_LOGGING_H */
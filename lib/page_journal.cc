@@ -0,0 +1,384 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "page_journal.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace gr {
+    namespace mixalot {
+
+        static const char JOURNAL_MAGIC[4] = { 'M', 'X', 'J', 'L' };
+        static const uint32_t JOURNAL_VERSION = 1;
+        static const size_t JOURNAL_HEADER = 16;
+        static const size_t JOURNAL_MIN_BYTES = 1024 * 1024;
+        // Compact in the background once the file is at least this big and
+        // mostly finished pages.
+        static const size_t JOURNAL_COMPACT_BYTES = 256 * 1024;
+
+        uint32_t
+        page_journal::checksum(const journal_record &rec, const uint8_t *payload) {
+            uint32_t h = 0x811c9dc5;
+            const uint8_t *p = (const uint8_t *)&rec + sizeof(rec.check);
+            for(size_t i = sizeof(rec.check); i < sizeof(rec); i++, p++) {
+                h = (h ^ *p) * 0x01000193;
+            }
+            for(size_t i = 0; i < rec.len; i++) {
+                h = (h ^ payload[i]) * 0x01000193;
+            }
+            // Never 0, so zero-filled space can't pass for a record.
+            return h ? h : 1;
+        }
+
+        page_journal::page_journal(const std::string &path, unsigned int sync_ms)
+          : d_path(path), d_fd(-1), d_map(0), d_capacity(0), d_end(0), d_synced(0), d_syncing(false),
+          d_live_bytes(0), d_next_id(1), d_records(0), d_syncs(0), d_sync_ms(sync_ms), d_stop(false)
+        {
+            const int fd = open(path.c_str(), O_RDONLY);
+            if(fd < 0 && errno != ENOENT) {
+                throw std::runtime_error(path + ": " + strerror(errno));
+            }
+            if(fd >= 0) {
+                struct stat st;
+                if(fstat(fd, &st) != 0) {
+                    const int err = errno;
+                    close(fd);
+                    throw std::runtime_error(path + ": " + strerror(err));
+                }
+                if(st.st_size > 0) {
+                    void *map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+                    const int err = errno;
+                    close(fd);
+                    if(map == MAP_FAILED) {
+                        throw std::runtime_error(path + ": " + strerror(err));
+                    }
+                    const bool ok = (size_t)st.st_size >= JOURNAL_HEADER
+                        && memcmp(map, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) == 0;
+                    if(ok) {
+                        load((const uint8_t *)map, st.st_size);
+                    }
+                    munmap(map, st.st_size);
+                    if(!ok) {
+                        throw std::runtime_error(path + ": not a page journal");
+                    }
+                } else {
+                    close(fd);
+                }
+            }
+            for(const auto &page : d_live) {
+                d_recovered.push_back(entry { page.first, page.second });
+            }
+            // Start from a clean file; this also drops a torn tail.
+            rewrite(std::max(JOURNAL_MIN_BYTES, JOURNAL_HEADER + d_live_bytes * 2));
+            d_sync_thread = std::thread(&page_journal::sync_loop, this);
+        }
+
+        page_journal::~page_journal() {
+            {
+                std::lock_guard<std::mutex> lock(d_mutex);
+                d_stop = true;
+            }
+            d_cond.notify_all();
+            d_sync_thread.join();
+            std::unique_lock<std::mutex> lock(d_mutex);
+            try {
+                record_done_later();
+            } catch(const std::exception &) {
+                // Those pages get sent again next time; nothing else to do.
+            }
+            flush_locked(lock);
+            munmap(d_map, d_capacity);
+            close(d_fd);
+        }
+
+        /**
+         * Replay the records in an existing journal into d_live.  Stops at
+         * the first record that's cut short or fails its check.
+         */
+        void
+        page_journal::load(const uint8_t *data, size_t size) {
+            uint32_t version;
+            memcpy(&version, data + 4, sizeof(version));
+            if(version != JOURNAL_VERSION) {
+                return;
+            }
+            for(size_t off = JOURNAL_HEADER; off + sizeof(journal_record) <= size; ) {
+                journal_record rec;
+                memcpy(&rec, data + off, sizeof(rec));
+                if(rec.len > size - off - sizeof(rec)) {
+                    break;
+                }
+                const uint8_t *payload = data + off + sizeof(rec);
+                if(rec.check != checksum(rec, payload)) {
+                    break;
+                }
+                d_next_id = std::max(d_next_id, rec.id + 1);
+                if(rec.type == JOURNAL_ACCEPTED) {
+                    d_live[rec.id].assign((const char *)payload, rec.len);
+                } else if(rec.type == JOURNAL_DONE) {
+                    d_live.erase(rec.id);
+                }
+                off += record_size(rec.len);
+            }
+            d_live_bytes = 0;
+            for(const auto &page : d_live) {
+                d_live_bytes += record_size(page.second.size());
+            }
+        }
+
+        std::vector<page_journal::entry>
+        page_journal::take_recovered() {
+            std::lock_guard<std::mutex> lock(d_mutex);
+            std::vector<entry> recovered;
+            recovered.swap(d_recovered);
+            return recovered;
+        }
+
+        uint64_t
+        page_journal::accepted(const std::string &cmd) {
+            std::lock_guard<std::mutex> lock(d_mutex);
+            const uint64_t id = d_next_id++;
+            append(JOURNAL_ACCEPTED, id, cmd);
+            d_live[id] = cmd;
+            d_live_bytes += record_size(cmd.size());
+            return id;
+        }
+
+        void
+        page_journal::done(uint64_t id) {
+            std::lock_guard<std::mutex> lock(d_mutex);
+            done_locked(id);
+        }
+
+        void
+        page_journal::done_later(uint64_t id) {
+            std::lock_guard<std::mutex> lock(d_later_mutex);
+            d_done_later.push_back(id);
+        }
+
+        // Append the done records queued by done_later().  Must be called
+        // with d_mutex held.
+        void
+        page_journal::record_done_later() {
+            std::vector<uint64_t> ids;
+            {
+                std::lock_guard<std::mutex> lock(d_later_mutex);
+                ids.swap(d_done_later);
+            }
+            for(uint64_t id : ids) {
+                done_locked(id);
+            }
+        }
+
+        // Must be called with d_mutex held.
+        void
+        page_journal::done_locked(uint64_t id) {
+            auto it = d_live.find(id);
+            if(it == d_live.end()) {
+                return;
+            }
+            append(JOURNAL_DONE, id, std::string());
+            d_live_bytes -= record_size(it->second.size());
+            d_live.erase(it);
+        }
+
+        /**
+         * Append one record.  Must be called with d_mutex held.  If the
+         * mapping is full, the journal is compacted first, into a bigger file
+         * if the unfinished pages take up more than half of it.  Throws
+         * std::runtime_error if the file can't be rewritten.
+         */
+        void
+        page_journal::append(record_type type, uint64_t id, const std::string &payload) {
+            const size_t size = record_size(payload.size());
+            if(d_end + size > d_capacity) {
+                // Can't remap under the sync thread.
+                std::unique_lock<std::mutex> lock(d_mutex, std::adopt_lock);
+                d_cond.wait(lock, [this] { return !d_syncing; });
+                lock.release();
+            }
+            if(d_end + size > d_capacity) {
+                size_t capacity = d_capacity;
+                while(JOURNAL_HEADER + (d_live_bytes + size) * 2 > capacity) {
+                    capacity *= 2;
+                }
+                rewrite(capacity);
+            }
+            journal_record rec;
+            memset(&rec, 0, sizeof(rec));
+            rec.len = payload.size();
+            rec.id = id;
+            rec.type = type;
+            uint8_t *dst = d_map + d_end;
+            memcpy(dst + sizeof(rec), payload.data(), payload.size());
+            rec.check = checksum(rec, dst + sizeof(rec));
+            memcpy(dst, &rec, sizeof(rec));
+            d_end += size;
+            d_records.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * Write the unfinished pages to a new file of the given size and
+         * rename it over the journal.  Must be called with d_mutex held and
+         * the sync thread out of msync() (or before it's started).
+         */
+        void
+        page_journal::rewrite(size_t capacity) {
+            const std::string tmp = d_path + ".tmp";
+            const int fd = open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if(fd < 0) {
+                throw std::runtime_error(tmp + ": " + strerror(errno));
+            }
+            if(ftruncate(fd, capacity) != 0) {
+                const int err = errno;
+                close(fd);
+                unlink(tmp.c_str());
+                throw std::runtime_error(tmp + ": " + strerror(err));
+            }
+            void *map = mmap(0, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(map == MAP_FAILED) {
+                const int err = errno;
+                close(fd);
+                unlink(tmp.c_str());
+                throw std::runtime_error(tmp + ": " + strerror(err));
+            }
+
+            uint8_t *oldmap = d_map;
+            const int oldfd = d_fd;
+            const size_t oldcapacity = d_capacity;
+            const size_t oldend = d_end;
+            d_map = (uint8_t *)map;
+            d_fd = fd;
+            d_capacity = capacity;
+            memcpy(d_map, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+            memcpy(d_map + 4, &JOURNAL_VERSION, sizeof(JOURNAL_VERSION));
+            d_end = JOURNAL_HEADER;
+            for(const auto &page : d_live) {
+                append(JOURNAL_ACCEPTED, page.first, page.second);
+            }
+            msync(d_map, d_end, MS_SYNC);
+            fsync(d_fd);
+            if(rename(tmp.c_str(), d_path.c_str()) != 0) {
+                const int err = errno;
+                munmap(d_map, d_capacity);
+                close(d_fd);
+                unlink(tmp.c_str());
+                d_map = oldmap;
+                d_fd = oldfd;
+                d_capacity = oldcapacity;
+                d_end = oldend;
+                throw std::runtime_error(d_path + ": " + strerror(err));
+            }
+            // Make the rename itself durable.
+            const size_t slash = d_path.rfind('/');
+            const std::string dir = (slash == std::string::npos) ? "." : d_path.substr(0, std::max<size_t>(slash, 1));
+            const int dirfd = open(dir.c_str(), O_RDONLY);
+            if(dirfd >= 0) {
+                fsync(dirfd);
+                close(dirfd);
+            }
+            d_synced = d_end;
+            if(oldmap != 0) {
+                munmap(oldmap, oldcapacity);
+                close(oldfd);
+            }
+        }
+
+        /**
+         * msync() whatever has been appended since the last sync.  Called with
+         * d_mutex held (through lock); the lock is dropped during msync() so
+         * appends can carry on, and d_syncing keeps the mapping in place.
+         */
+        void
+        page_journal::flush_locked(std::unique_lock<std::mutex> &lock) {
+            if(d_synced >= d_end || d_syncing) {
+                return;
+            }
+            static const size_t pagesize = sysconf(_SC_PAGESIZE);
+            const size_t start = d_synced & ~(pagesize - 1);
+            const size_t end = d_end;
+            d_syncing = true;
+            uint8_t *map = d_map;
+            lock.unlock();
+            msync(map + start, end - start, MS_SYNC);
+            lock.lock();
+            d_syncing = false;
+            d_synced = std::max(d_synced, end);
+            d_syncs.fetch_add(1, std::memory_order_relaxed);
+            d_cond.notify_all();
+        }
+
+        void
+        page_journal::sync() {
+            std::unique_lock<std::mutex> lock(d_mutex);
+            d_cond.wait(lock, [this] { return !d_syncing; });
+            record_done_later();
+            flush_locked(lock);
+        }
+
+        void
+        page_journal::compact() {
+            std::unique_lock<std::mutex> lock(d_mutex);
+            d_cond.wait(lock, [this] { return !d_syncing; });
+            record_done_later();
+            rewrite(std::max(JOURNAL_MIN_BYTES, JOURNAL_HEADER + d_live_bytes * 2));
+        }
+
+        size_t
+        page_journal::pending() const {
+            std::lock_guard<std::mutex> lock(d_mutex);
+            std::lock_guard<std::mutex> later(d_later_mutex);
+            size_t n = d_live.size();
+            for(uint64_t id : d_done_later) {
+                n -= d_live.count(id);
+            }
+            return n;
+        }
+
+        size_t
+        page_journal::bytes() const {
+            std::lock_guard<std::mutex> lock(d_mutex);
+            return d_end;
+        }
+
+        // Group commit: every d_sync_ms, record the pages finished with
+        // done_later() and flush, and compact when the file is mostly
+        // finished pages.
+        void
+        page_journal::sync_loop() {
+            const auto interval = std::chrono::milliseconds(d_sync_ms);
+            std::unique_lock<std::mutex> lock(d_mutex);
+            while(!d_cond.wait_for(lock, interval, [this] { return d_stop; })) {
+                try {
+                    record_done_later();
+                } catch(const std::exception &) {
+                    // The mapping was full and couldn't be rewritten; the
+                    // rest are lost, and those pages get sent again after
+                    // a restart.
+                }
+                flush_locked(lock);
+                if(d_end >= JOURNAL_COMPACT_BYTES && d_live_bytes * 4 < d_end) {
+                    try {
+                        rewrite(std::max(JOURNAL_MIN_BYTES, JOURNAL_HEADER + d_live_bytes * 2));
+                    } catch(const std::exception &) {
+                        // Try again next time; the old file is still good.
+                    }
+                }
+            }
+        }
+
+    } /* namespace mixalot */
+} /* namespace gr */
@@ -0,0 +1,131 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_PAGE_JOURNAL_H
+#define INCLUDED_MIXALOT_PAGE_JOURNAL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gr {
+    namespace mixalot {
+
+        /**
+         * Append-only journal of accepted page commands, so that pages that
+         * were queued but never acked survive a restart.
+         *
+         * Each accepted command gets a record with its text, and a page that
+         * has finished going out (which is when it's acked) or was dropped
+         * gets a "done" record.  Records are appended into a shared mapping of the file, so
+         * an append is a copy under a mutex.  A background thread writes the
+         * appended range out with msync() every sync_ms, so a burst of
+         * commands costs one flush (group commit); at most the last sync_ms
+         * of records can be lost in a crash.
+         *
+         * When the mapping fills up, or when most of the file is finished
+         * pages, the journal is compacted: the unfinished records are written
+         * to a new file, which is renamed over the old one.
+         *
+         * On disk: the 4 bytes "MXJL", a uint32_t version = 1 and a uint64_t
+         * (reserved, 0), then records, each 8-byte aligned: a journal_record
+         * header followed by len bytes of command text.  The check field is
+         * FNV-1a over the rest of the record; a record that doesn't match
+         * (torn by a crash) ends the journal.  Host byte order throughout.
+         */
+        class page_journal {
+        public:
+            enum record_type {
+                JOURNAL_ACCEPTED = 1,   // page accepted; the payload is its command
+                // 2 was "transmitted, not yet acked"; skipped if found
+                JOURNAL_DONE = 3,       // page acked (or dropped)
+            };
+
+            // A page that was accepted but not acked before the last shutdown.
+            struct entry {
+                uint64_t id;
+                std::string cmd;
+            };
+
+            // Open (or create) the journal at path and recover what's in it.
+            // Throws std::runtime_error if it can't.
+            page_journal(const std::string &path, unsigned int sync_ms = 10);
+            ~page_journal();
+
+            // The unfinished pages found when the journal was opened, oldest
+            // first.  Returns them once; later calls return nothing.
+            std::vector<entry> take_recovered();
+
+            // Record a newly accepted page; returns its id (never 0).
+            uint64_t accepted(const std::string &cmd);
+            void done(uint64_t id);
+            // Like done(), but only queues the id: the record is appended by
+            // the sync thread (or the next sync() or compact()), so this never
+            // waits for the file, a flush or a compaction.  For the streaming
+            // thread.
+            void done_later(uint64_t id);
+
+            // Write everything appended so far out to disk now.
+            void sync();
+            // Rewrite the journal with only the unfinished pages.
+            void compact();
+
+            size_t pending() const;                     // pages accepted but not done
+            size_t bytes() const;                       // bytes used in the file
+            uint64_t records() const { return d_records.load(std::memory_order_relaxed); }
+            uint64_t syncs() const { return d_syncs.load(std::memory_order_relaxed); }
+
+        private:
+            struct journal_record {
+                uint32_t check;
+                uint32_t len;           // bytes of payload after the header
+                uint64_t id;
+                uint16_t type;          // record_type
+                uint16_t pad[3];
+            };
+
+            std::string d_path;
+            int d_fd;
+            uint8_t *d_map;
+            size_t d_capacity;                  // size of the file and mapping
+            size_t d_end;                       // end of the last record
+            size_t d_synced;                    // d_map is on disk up to here
+            bool d_syncing;                     // sync thread is in msync(); don't remap
+            std::map<uint64_t, std::string> d_live; // commands of the unfinished pages, by id
+            size_t d_live_bytes;                // record bytes needed for d_live
+            uint64_t d_next_id;
+            std::vector<entry> d_recovered;
+            std::atomic<uint64_t> d_records;    // records appended
+            std::atomic<uint64_t> d_syncs;      // msync() calls
+
+            mutable std::mutex d_mutex;
+            mutable std::mutex d_later_mutex;   // guards d_done_later; taken after d_mutex, if at all
+            std::vector<uint64_t> d_done_later; // ids from done_later() not yet recorded
+            std::condition_variable d_cond;
+            std::thread d_sync_thread;
+            unsigned int d_sync_ms;
+            bool d_stop;
+
+            static size_t record_size(size_t len) { return (sizeof(journal_record) + len + 7) & ~(size_t)7; }
+            static uint32_t checksum(const journal_record &rec, const uint8_t *payload);
+            void load(const uint8_t *data, size_t size);
+            void append(record_type type, uint64_t id, const std::string &payload);
+            void done_locked(uint64_t id);
+            void record_done_later();
+            void rewrite(size_t capacity);
+            void flush_locked(std::unique_lock<std::mutex> &lock);
+            void sync_loop();
+        };
+
+    } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_PAGE_JOURNAL_H */
@@ -0,0 +1,60 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "page_pdu.h"
+#include <stdint.h>
+#include <vector>
+
+using std::string;
+
+namespace gr {
+    namespace mixalot {
+        /**
+         * Read a page from a PDU sent to the single-page encoders: the data is
+         * the message text, and the metadata can set "capcode" (an integer)
+         * and "type" ("alpha" or "numeric", the same as the pages pagerdecode
+         * publishes, or "auto").  msgtype and capcode are left alone if the metadata
+         * doesn't set them.  Returns false if the PDU isn't usable.
+         */
+        bool
+        page_from_pdu(pmt::pmt_t msg, int &msgtype, unsigned int &capcode, std::string &message) {
+            if(!pmt::is_pair(msg) || !pmt::is_u8vector(pmt::cdr(msg))) {
+                return false;
+            }
+            const pmt::pmt_t meta = pmt::car(msg);
+            if(pmt::is_dict(meta)) {
+                const pmt::pmt_t code = pmt::dict_ref(meta, pmt::mp("capcode"), pmt::PMT_NIL);
+                if(pmt::is_integer(code) || pmt::is_uint64(code)) {
+                    const uint64_t c = pmt::to_uint64(code);
+                    if(c > UINT32_MAX) {
+                        return false;
+                    }
+                    capcode = c;
+                }
+                const pmt::pmt_t type = pmt::dict_ref(meta, pmt::mp("type"), pmt::PMT_NIL);
+                if(pmt::is_symbol(type)) {
+                    const string t = pmt::symbol_to_string(type);
+                    if(t == "alpha") {
+                        msgtype = 1;
+                    } else if(t == "numeric") {
+                        msgtype = 0;
+                    } else if(t == "auto") {
+                        msgtype = 2;
+                    } else {
+                        return false;
+                    }
+                }
+            }
+            const std::vector<uint8_t> chars = pmt::u8vector_elements(pmt::cdr(msg));
+            message.assign(chars.begin(), chars.end());
+            return true;
+        }
+    }
+}
@@ -0,0 +1,19 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_PAGE_PDU_H
+#define INCLUDED_MIXALOT_PAGE_PDU_H
+
+#include <pmt/pmt.h>
+#include <string>
+
+namespace gr {
+    namespace mixalot {
+        bool page_from_pdu(pmt::pmt_t msg, int &msgtype, unsigned int &capcode, std::string &message);
+    }
+}
+
+#endif /* INCLUDED_MIXALOT_PAGE_PDU_H */
@@ -0,0 +1,696 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+// Decoders for the transmissions made by the encoder blocks.  These follow
+// what the encoders send (which is not all of each protocol): POCSAG
+// numeric/alpha/tone pages, FLEX short-address numeric and alpha pages in a
+// single frame, and GSC numeric and alpha pages.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pager_decoders.h"
+#include "utils.h"
+#include "golay.h"
+#include "gsc_tables.h"
+
+using std::string;
+using std::vector;
+
+namespace gr {
+    namespace mixalot {
+
+#define POCSAG_SYNCWORD 0x7CD215D8
+#define POCSAG_IDLEWORD 0x7A89C197
+#define FLEX_A1         0x78F35939
+
+        // Maximum bit errors accepted in a sync word
+#define SYNC_ERRORS     2
+
+        static inline unsigned int
+        bit_errors(uint32_t a, uint32_t b) {
+            return __builtin_popcount(a ^ b);
+        }
+
+        static void
+        strip_trailing_spaces(string &s) {
+            const size_t end = s.find_last_not_of(' ');
+            s.erase(end == string::npos ? 0 : end + 1);
+        }
+
+        // POCSAG numeric characters, indexed by the (bit-reversed) 4-bit code
+        // that make_numeric_message() sends.
+        static const char pocsag_numeric[] = "084 2S6]195-3U7[";
+
+        // FLEX numeric characters, indexed by the 4-bit code.
+        static const char flex_numeric[] = "0123456789SU -][";
+
+        // GSC numeric characters, indexed by the code gsc_message_chars()
+        // sends; 10 is the padding after the message.
+        static const char gsc_numeric[] = "0123456789 U -=E";
+
+        /**
+         * POCSAG: hunt for a sync codeword, then decode batches of 16
+         * codewords until a batch isn't followed by another sync codeword.
+         */
+        class pocsag_decoder : public page_decoder {
+        public:
+            pocsag_decoder(const string &protocol, unsigned int baudrate, page_callback cb)
+                : page_decoder(protocol, baudrate, cb), d_state(HUNT), d_shift(0), d_nbits(0),
+                d_invert(false), d_word(0), d_inmsg(false) { }
+
+            void push_bit(bool bit) override {
+                d_shift = (d_shift << 1) | (bit ? 1 : 0);
+                switch(d_state) {
+                    case HUNT:
+                        if(d_nbits < 32) {
+                            d_nbits++;
+                            if(d_nbits < 32) {
+                                break;
+                            }
+                        }
+                        if(bit_errors(d_shift, POCSAG_SYNCWORD) <= SYNC_ERRORS) {
+                            d_invert = false;
+                        } else if(bit_errors(~d_shift, POCSAG_SYNCWORD) <= SYNC_ERRORS) {
+                            d_invert = true;
+                        } else {
+                            break;
+                        }
+                        d_state = BATCH;
+                        d_nbits = 0;
+                        d_word = 0;
+                        break;
+                    case BATCH:
+                        if(++d_nbits == 32) {
+                            process_word(d_invert ? ~d_shift : d_shift);
+                            d_nbits = 0;
+                            if(++d_word == 16) {
+                                d_state = SYNC;
+                            }
+                        }
+                        break;
+                    case SYNC:
+                        if(++d_nbits == 32) {
+                            d_nbits = 0;
+                            if(bit_errors(d_invert ? ~d_shift : d_shift, POCSAG_SYNCWORD) <= SYNC_ERRORS) {
+                                d_state = BATCH;
+                                d_word = 0;
+                            } else {
+                                end_message();
+                                d_state = HUNT;
+                                d_nbits = 32;   // this word could be the start of a new sync
+                            }
+                        }
+                        break;
+                }
+            }
+
+            void flush() override {
+                end_message();
+                d_state = HUNT;
+                d_nbits = 0;
+            }
+
+        private:
+            enum { HUNT, BATCH, SYNC } d_state;
+            uint32_t d_shift;               // last 32 bits received
+            unsigned int d_nbits;           // bits into the current word
+            bool d_invert;                  // received polarity is inverted
+            unsigned int d_word;            // codeword index within the batch
+            bool d_inmsg;                   // d_page is in progress
+            decoded_page d_page;
+            vector<uint32_t> d_chunks;      // 20-bit message word payloads
+
+            void process_word(uint32_t w) {
+                uint32_t cw;
+                unsigned int nerrors;
+                if(!decodeword(w, cw, nerrors)) {
+                    if(d_inmsg) {
+                        d_page.uncorrectable++;
+                        d_chunks.push_back((w >> 11) & 0xFFFFF);
+                    }
+                    return;
+                }
+                if(cw == POCSAG_IDLEWORD) {
+                    end_message();
+                } else if((cw & 0x80000000) == 0) {
+                    // Address codeword: the low 3 bits of the capcode are the frame number.
+                    end_message();
+                    d_inmsg = true;
+                    d_page = decoded_page();
+                    d_page.protocol = d_protocol;
+                    d_page.capcode = (((cw >> 13) & 0x3FFFF) << 3) | (d_word / 2);
+                    d_page.function = (cw >> 11) & 3;
+                    d_page.corrected = nerrors;
+                    d_page.uncorrectable = 0;
+                    d_chunks.clear();
+                } else if(d_inmsg) {
+                    d_page.corrected += nerrors;
+                    d_chunks.push_back((cw >> 11) & 0xFFFFF);
+                }
+            }
+
+            void end_message() {
+                if(!d_inmsg) {
+                    return;
+                }
+                d_inmsg = false;
+                if(d_chunks.empty()) {
+                    d_page.type = "tone";
+                } else if(d_page.function == 0) {
+                    d_page.type = "numeric";
+                    for(uint32_t chunk : d_chunks) {
+                        for(int i = 16; i >= 0; i -= 4) {
+                            d_page.message += pocsag_numeric[(chunk >> i) & 0xf];
+                        }
+                    }
+                    strip_trailing_spaces(d_page.message);
+                } else {
+                    // 7-bit characters, LSB first, packed MSB first into the
+                    // 20-bit payloads.  A control character from NUL to EOT
+                    // ends the text (this also catches the padding).
+                    d_page.type = "alpha";
+                    unsigned char c = 0;
+                    unsigned int nb = 0;
+                    bool done = false;
+                    for(auto it = d_chunks.begin(); it != d_chunks.end() && !done; it++) {
+                        for(int i = 19; i >= 0; i--) {
+                            c |= ((*it >> i) & 1) << nb;
+                            if(++nb == 7) {
+                                if(c <= 0x04) {
+                                    done = true;
+                                    break;
+                                }
+                                d_page.message += (char)c;
+                                c = 0;
+                                nb = 0;
+                            }
+                        }
+                    }
+                }
+                d_callback(d_page);
+            }
+        };
+
+        /**
+         * FLEX (1600 bps, 2-level): hunt for sync word A1, skip to the frame
+         * information word, then deinterleave and decode the 11 blocks of the
+         * frame.
+         */
+        class flex_decoder : public page_decoder {
+        public:
+            flex_decoder(page_callback cb)
+                : page_decoder("flex", 1600, cb), d_state(HUNT), d_shift(0), d_count(0), d_invert(false) { }
+
+            void push_bit(bool bit) override {
+                d_shift = (d_shift << 1) | (bit ? 1 : 0);
+                switch(d_state) {
+                    case HUNT:
+                        if(d_count < 32) {
+                            d_count++;
+                            if(d_count < 32) {
+                                break;
+                            }
+                        }
+                        if(bit_errors(d_shift, FLEX_A1) <= SYNC_ERRORS) {
+                            d_invert = false;
+                        } else if(bit_errors(~d_shift, FLEX_A1) <= SYNC_ERRORS) {
+                            d_invert = true;
+                        } else {
+                            break;
+                        }
+                        d_state = SKIP_SYNC;
+                        d_count = 0;
+                        break;
+                    case SKIP_SYNC:             // B and inverted A1
+                        if(++d_count == 48) {
+                            d_state = FIW;
+                            d_count = 0;
+                        }
+                        break;
+                    case FIW: {
+                        if(++d_count == 32) {
+                            uint32_t cw;
+                            unsigned int nerrors;
+                            d_count = 0;
+                            if(decodeword(d_invert ? ~d_shift : d_shift, cw, nerrors)) {
+                                d_state = SKIP_C;
+                            } else {
+                                d_state = HUNT;
+                                d_count = 32;
+                            }
+                        }
+                        break;
+                    }
+                    case SKIP_C:                // sync 2 ("C" block)
+                        if(++d_count == 40) {
+                            d_state = BLOCKS;
+                            d_bits.clear();
+                        }
+                        break;
+                    case BLOCKS:
+                        d_bits.push_back((bit ? 1 : 0) ^ (d_invert ? 1 : 0));
+                        if(d_bits.size() == 11 * 256) {
+                            decode_frame();
+                            d_state = HUNT;
+                            d_count = 0;
+                        }
+                        break;
+                }
+            }
+
+            void flush() override {
+                d_state = HUNT;
+                d_count = 0;
+            }
+
+        private:
+            enum { HUNT, SKIP_SYNC, FIW, SKIP_C, BLOCKS } d_state;
+            uint32_t d_shift;               // last 32 bits received
+            unsigned int d_count;           // bits into the current state
+            bool d_invert;                  // received polarity is inverted
+            vector<uint8_t> d_bits;         // interleaved block bits
+
+            void decode_frame() {
+                uint32_t words[88];             // 21-bit data words
+                bool ok[88];
+                unsigned int nerrors[88];
+                for(int block = 0; block < 11; block++) {
+                    uint32_t raw[8] = { 0 };
+                    const uint8_t *bits = &d_bits[block * 256];
+                    for(int i = 0; i < 32; i++) {
+                        for(int j = 0; j < 8; j++) {
+                            raw[j] = (raw[j] << 1) | bits[i * 8 + j];
+                        }
+                    }
+                    for(int j = 0; j < 8; j++) {
+                        const int k = block * 8 + j;
+                        uint32_t cw;
+                        ok[k] = decodeword(raw[j], cw, nerrors[k]);
+                        words[k] = reverse_bits32(ok[k] ? cw : raw[j]) & 0x1FFFFF;
+                    }
+                }
+                if(!ok[0]) {
+                    return;
+                }
+                // The address field runs from after the BIWs to the vector
+                // field, which should hold one vector per address word.
+                // flexencode sends a single vector for all the capcodes of a
+                // multi-capcode page, with the message right after it, so
+                // the field ends early where the first message starts.
+                const unsigned int addrstart = 1 + ((words[0] >> 8) & 3);
+                const unsigned int vecstart = (words[0] >> 10) & 0x3f;
+                if(vecstart <= addrstart || vecstart >= 88) {
+                    return;
+                }
+                const unsigned int naddrs = vecstart - addrstart;
+                unsigned int nvecs = naddrs;
+                if(ok[vecstart] && is_vector(words[vecstart])) {
+                    const unsigned int mstart = (words[vecstart] >> 7) & 0x7f;
+                    if(mstart > vecstart && mstart < vecstart + nvecs) {
+                        nvecs = mstart - vecstart;
+                    }
+                }
+                for(unsigned int a = addrstart; a < vecstart; a++) {
+                    if(!ok[a] || words[a] < 32769 || words[a] > 1966080) {
+                        continue;           // only short addresses are sent
+                    }
+                    unsigned int vi;
+                    if(nvecs == naddrs) {
+                        vi = vecstart + (a - addrstart);
+                    } else if(nvecs == 1) {
+                        vi = vecstart;
+                    } else {
+                        continue;
+                    }
+                    if(vi >= 88 || !is_vector(words[vi])) {
+                        continue;
+                    }
+                    decoded_page page;
+                    page.protocol = d_protocol;
+                    page.capcode = words[a] - 32768;
+                    page.function = -1;
+                    page.corrected = nerrors[a] + nerrors[vi];
+                    page.uncorrectable = 0;
+
+                    const uint32_t vec = words[vi];
+                    const unsigned int mstart = (vec >> 7) & 0x7f;
+                    unsigned int nwords;
+                    if(((vec >> 4) & 7) == 5) {
+                        page.type = "alpha";
+                        nwords = (vec >> 14) & 0x7f;
+                    } else {
+                        page.type = "numeric";
+                        nwords = ((vec >> 14) & 7) + 1;
+                    }
+                    if(mstart < 1 || nwords < 1 || mstart + nwords > 88) {
+                        continue;
+                    }
+                    for(unsigned int i = mstart; i < mstart + nwords; i++) {
+                        if(ok[i]) {
+                            page.corrected += nerrors[i];
+                        } else {
+                            page.uncorrectable++;
+                        }
+                    }
+                    if(page.type == "alpha") {
+                        // Word 0 holds the checksum and fragment info, and
+                        // the first character slot of word 1 is the
+                        // signature; after that, three 7-bit characters per
+                        // word, padded with ETX.
+                        for(unsigned int i = mstart + 1; i < mstart + nwords; i++) {
+                            bool done = false;
+                            for(int shift = (i == mstart + 1) ? 7 : 0; shift < 21; shift += 7) {
+                                const char c = (words[i] >> shift) & 0x7f;
+                                if(c == 0x03) {
+                                    done = true;
+                                    break;
+                                }
+                                page.message += c;
+                            }
+                            if(done) {
+                                break;
+                            }
+                        }
+                    } else {
+                        // 4-bit characters, LSB first, in a stream of 21-bit
+                        // words; the first two bits are part of the checksum.
+                        const unsigned int totalbits = nwords * 21;
+                        for(unsigned int pos = 2; pos + 4 <= totalbits; pos += 4) {
+                            unsigned int val = 0;
+                            for(unsigned int b = 0; b < 4; b++) {
+                                const unsigned int bitpos = pos + b;
+                                val |= ((words[mstart + bitpos / 21] >> (bitpos % 21)) & 1) << b;
+                            }
+                            page.message += flex_numeric[val];
+                        }
+                        strip_trailing_spaces(page.message);
+                    }
+                    d_callback(page);
+                }
+            }
+
+            static bool is_vector(uint32_t dw) {
+                const uint32_t type = (dw >> 4) & 7;
+                return type == 3 || type == 5;
+            }
+        };
+
+        /**
+         * GSC: hunt for the start code (at 600 bps, where each 300 bps bit
+         * is two symbols), identify the preamble that came before it, then
+         * decode the address and data blocks.
+         */
+        class gsc_decoder : public page_decoder {
+        public:
+            gsc_decoder(page_callback cb)
+                : page_decoder("gsc", 600, cb), d_state(HUNT), d_invert(false), d_preamble(0), d_nblocks(0) {
+                const vector<uint8_t> word = golay_symbols(gsc_startcode);
+                d_startcode = word;
+                d_startcode.push_back(1);
+                for(uint8_t b : word) {
+                    d_startcode.push_back(b ^ 1);
+                }
+                for(uint32_t info = 0; info < 128; info++) {
+                    d_bchwords[info] = encode_bch15_7(info);
+                }
+            }
+
+            void push_bit(bool bit) override {
+                const uint8_t b = bit ? 1 : 0;
+                switch(d_state) {
+                    case HUNT:
+                        d_hist.push_back(b);
+                        if(d_hist.size() > HIST_SIZE) {
+                            d_hist.erase(d_hist.begin());
+                        }
+                        check_startcode();
+                        break;
+                    case ADDRESS:
+                        d_bits.push_back(b ^ (d_invert ? 1 : 0));
+                        if(d_bits.size() == 121) {
+                            decode_address();
+                            d_bits.clear();
+                        }
+                        break;
+                    case BLOCKS:
+                        d_bits.push_back(b ^ (d_invert ? 1 : 0));
+                        if(d_bits.size() == 121) {
+                            decode_block();
+                            d_bits.clear();
+                        }
+                        break;
+                }
+            }
+
+            void flush() override {
+                if(d_state == BLOCKS) {
+                    finish_page();
+                }
+                reset();
+            }
+
+        private:
+            // Preamble word, comma and start code
+            static const size_t HIST_SIZE = 46 + 28 + 93;
+            // Mismatches accepted in the 93-symbol start code
+            static const unsigned int STARTCODE_ERRORS = 8;
+
+            enum { HUNT, ADDRESS, BLOCKS } d_state;
+            vector<uint8_t> d_hist;         // recent bits, while hunting
+            vector<uint8_t> d_bits;         // bits of the current address or block
+            vector<uint8_t> d_startcode;    // start code as transmitted
+            uint32_t d_bchwords[128];       // BCH(15,7) codeword for each 7-bit info word
+            bool d_invert;                  // received polarity is inverted
+            unsigned int d_preamble;        // preamble index of the current page
+            unsigned int d_nblocks;         // data blocks received for the current page
+            vector<uint8_t> d_chars;        // 6-bit characters of the current page
+            decoded_page d_page;
+
+            void reset() {
+                d_state = HUNT;
+                d_hist.clear();
+                d_bits.clear();
+            }
+
+            // The symbols for one Golay codeword at 300 bps: 12 data bits
+            // then 11 parity bits, LSB first, each sent twice.
+            static vector<uint8_t> golay_symbols(uint32_t data) {
+                const unsigned long cw = calcgolay(data);
+                vector<uint8_t> out;
+                for(int i = 0; i < 12; i++) {
+                    out.push_back((data >> i) & 1);
+                    out.push_back((data >> i) & 1);
+                }
+                for(int i = 0; i < 11; i++) {
+                    out.push_back((cw >> i) & 1);
+                    out.push_back((cw >> i) & 1);
+                }
+                return out;
+            }
+
+            // Decode 46 symbols (see golay_symbols) into 12 data bits.
+            uint32_t golay_data(const uint8_t *sym, bool invert, int &nerrors) {
+                unsigned long data = 0, parity = 0;
+                for(int i = 0; i < 12; i++) {
+                    data |= (unsigned long)(sym[i * 2] ^ (invert ? 1 : 0)) << i;
+                }
+                for(int i = 0; i < 11; i++) {
+                    parity |= (unsigned long)(sym[24 + i * 2] ^ (invert ? 1 : 0)) << i;
+                }
+                return golay_decode((data << 11) | parity, &nerrors) >> 11;
+            }
+
+            void check_startcode() {
+                if(d_hist.size() < HIST_SIZE) {
+                    return;
+                }
+                const uint8_t *sc = &d_hist[HIST_SIZE - 93];
+                unsigned int mismatches = 0;
+                for(size_t i = 0; i < 93; i++) {
+                    mismatches += sc[i] ^ d_startcode[i];
+                }
+                if(mismatches <= STARTCODE_ERRORS) {
+                    d_invert = false;
+                } else if(93 - mismatches <= STARTCODE_ERRORS) {
+                    d_invert = true;
+                } else {
+                    return;
+                }
+                int nerrors;
+                const uint32_t pre = golay_data(&d_hist[0], d_invert, nerrors);
+                for(d_preamble = 0; d_preamble < 10; d_preamble++) {
+                    if(preamble_values[d_preamble] == pre) {
+                        break;
+                    }
+                }
+                if(d_preamble == 10) {
+                    return;
+                }
+                d_state = ADDRESS;
+                d_bits.clear();
+            }
+
+            void decode_address() {
+                int errors1, errors2;
+                // The first word is sent complemented.
+                uint32_t word1 = golay_data(&d_bits[28], true, errors1);
+                const uint32_t word2 = golay_data(&d_bits[28 + 46 + 1], false, errors2);
+                unsigned int g1g0;
+                for(g1g0 = 0; g1g0 < 50; g1g0++) {
+                    if(word1s[g1g0] == word1) {
+                        break;
+                    }
+                }
+                if(g1g0 == 50) {
+                    reset();
+                    return;
+                }
+                // See gscencode_impl::calc_pagerid().
+                const bool high = (word2 % 100) >= 50;
+                const unsigned int b1b0 = (word2 % 100) - (high ? 50 : 0);
+                const unsigned int b3b2 = word2 / 100;
+                if(high) {
+                    g1g0 += 50;
+                }
+                const unsigned int i = (d_preamble + 10 - (g1g0 % 10)) % 10;
+
+                d_page = decoded_page();
+                d_page.protocol = d_protocol;
+                d_page.capcode = i * 100000 + g1g0 * 1000 + b3b2 * 50 + b1b0;
+                d_page.function = -1;
+                d_page.corrected = errors1 + errors2;
+                d_page.uncorrectable = 0;
+                d_nblocks = 0;
+                d_chars.clear();
+                d_state = BLOCKS;
+            }
+
+            void decode_block() {
+                uint32_t infowords[8];
+                for(int w = 0; w < 8; w++) {
+                    uint32_t cw = 0;
+                    for(int r = 0; r < 15; r++) {
+                        cw |= (uint32_t)d_bits[1 + r * 8 + w] << r;
+                    }
+                    unsigned int best = 0, bestdist = 16;
+                    for(unsigned int info = 0; info < 128 && bestdist > 0; info++) {
+                        const unsigned int dist = __builtin_popcount(cw ^ d_bchwords[info]);
+                        if(dist < bestdist) {
+                            best = info;
+                            bestdist = dist;
+                        }
+                    }
+                    if(bestdist > 2) {
+                        d_page.uncorrectable++;
+                    } else {
+                        d_page.corrected += bestdist;
+                    }
+                    infowords[w] = best;
+                }
+                uint32_t checkval = 0;
+                for(int i = 0; i < 7; i++) {
+                    checkval += infowords[i];
+                }
+                if((checkval & 0x7f) != infowords[7]) {
+                    d_page.uncorrectable++;
+                }
+
+                // Seven 6-bit characters across the first six info words,
+                // then the eighth with the continue bit.
+                unsigned char chars[8];
+                uint64_t bits = 0;
+                for(int i = 5; i >= 0; i--) {
+                    bits = (bits << 7) | infowords[i];
+                }
+                for(int i = 0; i < 7; i++) {
+                    chars[i] = (bits >> (i * 6)) & 0x3f;
+                }
+                chars[7] = infowords[6] & 0x3f;
+                const bool continuebit = (infowords[6] >> 6) & 1;
+                d_chars.insert(d_chars.end(), chars, chars + 8);
+
+                // A page can't really be this long; don't run on forever if
+                // the continue bit is corrupted.
+                if(!continuebit || ++d_nblocks >= 64) {
+                    finish_page();
+                    reset();
+                }
+            }
+
+            // Numeric and alpha pages are sent in the same blocks, and the
+            // address doesn't say which it is.  A numeric page is all 4-bit
+            // codes, padded with 10; an alpha page ends with 0x3e unless it
+            // fills its last block, and its only characters below 0x10 are
+            // space and punctuation, so a page with nothing above 0xf is
+            // taken as numeric.
+            void finish_page() {
+                bool numeric = !d_chars.empty();
+                for(uint8_t c : d_chars) {
+                    if(c > 0xf) {
+                        numeric = false;
+                        break;
+                    }
+                }
+                if(numeric) {
+                    d_page.type = "numeric";
+                    size_t len = d_chars.size();
+                    while(len > 0 && d_chars[len - 1] == 10) {
+                        len--;
+                    }
+                    for(size_t i = 0; i < len; i++) {
+                        d_page.message += gsc_numeric[d_chars[i]];
+                    }
+                } else {
+                    d_page.type = "alpha";
+                    for(uint8_t c : d_chars) {
+                        if(c == 0x3e) {
+                            break;
+                        } else if(c == 0x3c) {
+                            d_page.message += '\n';
+                        } else {
+                            d_page.message += (char)(c + 0x20);
+                        }
+                    }
+                }
+                d_callback(d_page);
+            }
+        };
+
+        std::unique_ptr<page_decoder>
+        make_page_decoder(const string &protocol, page_callback cb) {
+            if(protocol == "pocsag512") {
+                return std::unique_ptr<page_decoder>(new pocsag_decoder(protocol, 512, cb));
+            } else if(protocol == "pocsag1200") {
+                return std::unique_ptr<page_decoder>(new pocsag_decoder(protocol, 1200, cb));
+            } else if(protocol == "pocsag2400") {
+                return std::unique_ptr<page_decoder>(new pocsag_decoder(protocol, 2400, cb));
+            } else if(protocol == "flex") {
+                return std::unique_ptr<page_decoder>(new flex_decoder(cb));
+            } else if(protocol == "gsc") {
+                return std::unique_ptr<page_decoder>(new gsc_decoder(cb));
+            }
+            return std::unique_ptr<page_decoder>();
+        }
+
+        vector<decoded_page>
+        decode_packed_bits(const string &protocol, const uint8_t *packed, size_t nbits) {
+            vector<decoded_page> pages;
+            std::unique_ptr<page_decoder> dec = make_page_decoder(protocol,
+                    [&pages](const decoded_page &page) { pages.push_back(page); });
+            if(!dec) {
+                return pages;
+            }
+            for(size_t i = 0; i < nbits; i++) {
+                dec->push_bit((packed[i / 8] >> (7 - (i % 8))) & 1);
+            }
+            dec->flush();
+            return pages;
+        }
+
+    } /* namespace mixalot */
+} /* namespace gr */
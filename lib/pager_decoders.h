@@ -0,0 +1,100 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_PAGER_DECODERS_H
+#define INCLUDED_MIXALOT_PAGER_DECODERS_H
+
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gr {
+    namespace mixalot {
+
+        // One page recovered by a decoder.
+        struct decoded_page {
+            std::string protocol;           // "pocsag512", "pocsag1200", "pocsag2400", "flex" or "gsc"
+            uint32_t capcode;
+            int function;                   // POCSAG function bits (-1 for other protocols)
+            std::string type;               // "alpha", "numeric" or "tone"
+            std::string message;
+            unsigned int corrected;         // bit errors corrected in this page's codewords
+            unsigned int uncorrectable;     // codewords with too many errors to correct
+        };
+
+        typedef std::function<void(const decoded_page &)> page_callback;
+
+        /**
+         * Turns a stream of symbols, each repeated sps times, back into bits.
+         * It samples in the middle of each symbol and re-centres on every
+         * transition, so it tolerates a little timing drift.
+         */
+        class symbol_slicer {
+        public:
+            explicit symbol_slicer(unsigned int sps) : d_sps(sps), d_count(0), d_last(false) { }
+
+            // Feed one sample; returns true (and sets bit) when a bit is ready.
+            inline bool push(bool level, bool &bit) {
+                if(level != d_last) {
+                    d_last = level;
+                    d_count = 0;
+                }
+                const bool ready = (d_count == d_sps / 2);
+                bit = level;
+                if(++d_count == d_sps) {
+                    d_count = 0;
+                }
+                return ready;
+            }
+
+        private:
+            unsigned int d_sps;     // samples per symbol
+            unsigned int d_count;   // samples since the start of the current symbol
+            bool d_last;            // level of the previous sample
+        };
+
+        /**
+         * Base class for the protocol decoders.  Bits go in one at a time (in
+         * either polarity; each decoder works that out from the sync word),
+         * and each page found is passed to the callback.
+         */
+        class page_decoder {
+        public:
+            page_decoder(const std::string &protocol, unsigned int baudrate, page_callback cb)
+                : d_protocol(protocol), d_baudrate(baudrate), d_callback(cb) { }
+            virtual ~page_decoder() { }
+
+            virtual void push_bit(bool bit) = 0;
+            // End of input: finish any page in progress and start hunting again.
+            virtual void flush() { }
+
+            const std::string &protocol() const { return d_protocol; }
+            unsigned int baudrate() const { return d_baudrate; }
+
+        protected:
+            std::string d_protocol;
+            unsigned int d_baudrate;
+            page_callback d_callback;
+        };
+
+        /**
+         * Make a decoder for "pocsag512", "pocsag1200", "pocsag2400", "flex" or
+         * "gsc".  Returns an empty pointer for anything else.
+         */
+        std::unique_ptr<page_decoder> make_page_decoder(const std::string &protocol, page_callback cb);
+
+        /**
+         * Decode a packed bitstream (one bit per symbol, MSB first) and return
+         * the pages found in it.
+         */
+        std::vector<decoded_page> decode_packed_bits(const std::string &protocol, const uint8_t *packed, size_t nbits);
+
+    } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_PAGER_DECODERS_H */
@@ -0,0 +1,156 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gnuradio/io_signature.h>
+#include "pagerdecode_impl.h"
+
+using std::string;
+
+namespace gr {
+    namespace mixalot {
+
+        pagerdecode::sptr
+        pagerdecode::make(unsigned long symrate, bool pocsag, bool flex, bool gsc) {
+            return gnuradio::get_initial_sptr (new pagerdecode_impl(symrate, pocsag, flex, gsc));
+        }
+
+        pagerdecode_impl::pagerdecode_impl(unsigned long symrate, bool pocsag, bool flex, bool gsc)
+            : gr::sync_block("pagerdecode",
+                    gr::io_signature::make(1, 1, sizeof(char)),
+                    gr::io_signature::make(0, 0, 0)),
+            d_symrate(symrate)
+        {
+            if(pocsag) {
+                add_decoder("pocsag512");
+                add_decoder("pocsag1200");
+                add_decoder("pocsag2400");
+            }
+            if(flex) {
+                add_decoder("flex");
+            }
+            if(gsc) {
+                add_decoder("gsc");
+            }
+            message_port_register_out(pmt::mp("pages"));
+            message_port_register_in(pmt::mp("bits"));
+            set_msg_handler(pmt::mp("bits"), [this](pmt::pmt_t msg) { this->bits_message(msg); });
+        }
+
+        pagerdecode_impl::~pagerdecode_impl() {
+        }
+
+        void
+        pagerdecode_impl::add_decoder(const string &protocol) {
+            std::unique_ptr<page_decoder> dec = make_page_decoder(protocol,
+                    [this](const decoded_page &page) { this->publish(page); });
+            const unsigned int baud = dec->baudrate();
+            if(d_symrate % baud != 0 || d_symrate / baud < 2) {
+                d_logger->warn("symbol rate {} is not a multiple of {} baud; not decoding {}", d_symrate, baud, protocol);
+                return;
+            }
+            d_channels.emplace_back(std::move(dec), d_symrate / baud);
+        }
+
+        void
+        pagerdecode_impl::publish(const decoded_page &page) {
+            d_pages.add();
+            d_corrected.add(page.corrected);
+            d_uncorrectable.add(page.uncorrectable);
+
+            pmt::pmt_t meta = pmt::make_dict();
+            meta = pmt::dict_add(meta, pmt::mp("protocol"), pmt::mp(page.protocol));
+            meta = pmt::dict_add(meta, pmt::mp("capcode"), pmt::from_uint64(page.capcode));
+            meta = pmt::dict_add(meta, pmt::mp("type"), pmt::mp(page.type));
+            if(page.function >= 0) {
+                meta = pmt::dict_add(meta, pmt::mp("function"), pmt::from_long(page.function));
+            }
+            meta = pmt::dict_add(meta, pmt::mp("corrected"), pmt::from_uint64(page.corrected));
+            meta = pmt::dict_add(meta, pmt::mp("uncorrectable"), pmt::from_uint64(page.uncorrectable));
+            const pmt::pmt_t data = pmt::init_u8vector(page.message.length(), (const uint8_t *)page.message.c_str());
+            message_port_pub(pmt::mp("pages"), pmt::cons(meta, data));
+        }
+
+        /**
+         * A packed bitstream to decode; the metadata names the protocol.
+         */
+        void
+        pagerdecode_impl::bits_message(pmt::pmt_t msg) {
+            if(!pmt::is_pair(msg)) {
+                d_logger->warn("bits: expected a PDU");
+                return;
+            }
+            const pmt::pmt_t meta = pmt::car(msg);
+            const pmt::pmt_t data = pmt::cdr(msg);
+            const pmt::pmt_t proto = pmt::dict_ref(meta, pmt::mp("protocol"), pmt::PMT_NIL);
+            if(!pmt::is_symbol(proto) || !pmt::is_u8vector(data)) {
+                d_logger->warn("bits: expected a u8vector PDU with a protocol");
+                return;
+            }
+            const string protocol = pmt::symbol_to_string(proto);
+            size_t len = 0;
+            const uint8_t *packed = pmt::u8vector_elements(data, len);
+            const pmt::pmt_t nbits = pmt::dict_ref(meta, pmt::mp("nbits"), pmt::PMT_NIL);
+            size_t n = len * 8;
+            if(pmt::is_integer(nbits) && (size_t)pmt::to_long(nbits) < n) {
+                n = pmt::to_long(nbits);
+            }
+            std::unique_ptr<page_decoder> dec = make_page_decoder(protocol,
+                    [this](const decoded_page &page) { this->publish(page); });
+            if(!dec) {
+                d_logger->warn("bits: unknown protocol {}", protocol);
+                return;
+            }
+            for(size_t i = 0; i < n; i++) {
+                dec->push_bit((packed[i / 8] >> (7 - (i % 8))) & 1);
+            }
+            dec->flush();
+        }
+
+        // Finish any page still in progress at the end of the stream.
+        bool
+        pagerdecode_impl::stop() {
+            for(channel &ch : d_channels) {
+                ch.decoder->flush();
+            }
+            return true;
+        }
+
+        long
+        pagerdecode_impl::pages_decoded() const {
+            return d_pages.get();
+        }
+        long
+        pagerdecode_impl::corrected_errors() const {
+            return d_corrected.get();
+        }
+        long
+        pagerdecode_impl::uncorrectable_words() const {
+            return d_uncorrectable.get();
+        }
+
+        int
+        pagerdecode_impl::work(int noutput_items,
+                gr_vector_const_void_star &input_items,
+                gr_vector_void_star &output_items)
+        {
+            const signed char *in = (const signed char *) input_items[0];
+            for(channel &ch : d_channels) {
+                for(int i = 0; i < noutput_items; i++) {
+                    bool bit;
+                    if(ch.slicer.push(in[i] > 0, bit)) {
+                        ch.decoder->push_bit(bit);
+                    }
+                }
+            }
+            return noutput_items;
+        }
+
+    } /* namespace mixalot */
+} /* namespace gr */
@@ -0,0 +1,58 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_PAGERDECODE_IMPL_H
+#define INCLUDED_MIXALOT_PAGERDECODE_IMPL_H
+
+#include <gnuradio/mixalot/pagerdecode.h>
+#include <memory>
+#include <vector>
+#include "pager_decoders.h"
+#include "perf_counters.h"
+
+namespace gr {
+  namespace mixalot {
+
+    class pagerdecode_impl : public pagerdecode
+    {
+    private:
+        // A decoder and the slicer that feeds it bits from the symbol stream.
+        struct channel {
+            std::unique_ptr<page_decoder> decoder;
+            symbol_slicer slicer;
+            channel(std::unique_ptr<page_decoder> dec, unsigned int sps) : decoder(std::move(dec)), slicer(sps) { }
+        };
+
+        unsigned long d_symrate;            // input symbol rate
+        std::vector<channel> d_channels;    // one per protocol/baud rate decoded
+
+        perf_counter d_pages;               // pages published
+        perf_counter d_corrected;           // bit errors corrected
+        perf_counter d_uncorrectable;       // codewords that couldn't be corrected
+
+        void add_decoder(const std::string &protocol);
+        void publish(const decoded_page &page);
+
+    public:
+      pagerdecode_impl(unsigned long symrate, bool pocsag, bool flex, bool gsc);
+      ~pagerdecode_impl();
+
+        void bits_message(pmt::pmt_t msg);
+        bool stop() override;
+
+        long pages_decoded() const override;
+        long corrected_errors() const override;
+        long uncorrectable_words() const override;
+
+        int work(int noutput_items,
+           gr_vector_const_void_star &input_items,
+           gr_vector_void_star &output_items);
+    };
+
+  } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_PAGERDECODE_IMPL_H */
@@ -0,0 +1,58 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_PERF_COUNTERS_H
+#define INCLUDED_MIXALOT_PERF_COUNTERS_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace gr {
+    namespace mixalot {
+
+        // A counter that can be bumped from any thread without taking a lock.
+        // Relaxed ordering is enough: readers only want a recent value, not
+        // a consistent snapshot across counters.
+        class perf_counter {
+        public:
+            perf_counter() : d_val(0) { }
+            inline void add(uint64_t n = 1) { d_val.fetch_add(n, std::memory_order_relaxed); }
+            inline uint64_t get() const { return d_val.load(std::memory_order_relaxed); }
+        private:
+            std::atomic<uint64_t> d_val;
+        };
+
+        // Histogram with power-of-two buckets: bucket 0 counts the value 0,
+        // bucket i counts values in [2^(i-1), 2^i), and the last bucket
+        // also takes everything larger.
+        class perf_histogram {
+        public:
+            static const int NBUCKETS = 32;
+
+            inline void add(uint64_t val) {
+                int bucket = 0;
+                while(val != 0 && bucket < NBUCKETS - 1) {
+                    val >>= 1;
+                    bucket++;
+                }
+                d_buckets[bucket].add();
+            }
+            std::vector<uint64_t> get() const {
+                std::vector<uint64_t> out(NBUCKETS);
+                for(int i = 0; i < NBUCKETS; i++) {
+                    out[i] = d_buckets[i].get();
+                }
+                return out;
+            }
+        private:
+            perf_counter d_buckets[NBUCKETS];
+        };
+
+    } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_PERF_COUNTERS_H */
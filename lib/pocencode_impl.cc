@@ -13,9 +13,9 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
-#include "utils.h"
+#include <gnuradio/mixalot/core.h>
+#include "page_pdu.h"
 
-using namespace itpp;
 using std::string;
 using std::shared_ptr;
 
@@ -32,115 +32,89 @@ namespace gr {
             return (b >> 1);
         }
         pocencode::sptr
-        pocencode::make(int type, unsigned int baudrate, unsigned int capcode, std::string message, unsigned long symrate) {
-            return gnuradio::get_initial_sptr (new pocencode_impl(type, baudrate, capcode, message, symrate));
+        pocencode::make(int type, unsigned int baudrate, unsigned int capcode, std::string message, unsigned long symrate, bool persistent) {
+            return gnuradio::get_initial_sptr (new pocencode_impl(type, baudrate, capcode, message, symrate, persistent));
         }
 
 
-#define POCSAG_SYNCWORD 0x7CD215D8
-        //#define POCSAG_IDLEWORD 0x7AC9C197
-#define POCSAG_IDLEWORD 0x7A89C197
-        void
-        pocencode_impl::queue_batch() {
-            std::vector<uint32_t> msgwords;
-            uint32_t functionbits = 0;
-            switch(d_msgtype) {
-                case Numeric:
-                    make_numeric_message(d_message, msgwords);
-                    functionbits = 0;
-                    break;
-                case Alpha:
-                    make_alpha_message(d_message, msgwords);
-                    functionbits = 3;
-                    break;
-                default:
-                    throw std::runtime_error("Invalid message type specified.");
-            }
-            msgwords.push_back(POCSAG_IDLEWORD);
-
-            static const shared_ptr<bvec> preamble = get_vec("101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010101010");
-            const uint32_t addrtemp = (d_capcode >> 3) << 13 | ((functionbits & 3) << 11);
-            const uint32_t addrword = encodeword(addrtemp);
-            const uint32_t frameoffset = d_capcode & 7;
-
-            assert((addrword & 0xFFFFF800) == addrtemp);
-
-            queue(preamble);
-            queue(POCSAG_SYNCWORD);
-
-            for(int i = 0; i < frameoffset; i++) {
-                queue(POCSAG_IDLEWORD);
-                queue(POCSAG_IDLEWORD);
-            }
-            queue(addrword);
-            std::vector<uint32_t>::iterator it = msgwords.begin();
-
-            for(int i = (frameoffset * 2)+1; i < 16; i++) {
-                if(it != msgwords.end()) {
-                    queue(*it);
-                    it++;
-                } else {
-                    queue(POCSAG_IDLEWORD);
-                }
-            }
-            while(it != msgwords.end()) {
-                queue(POCSAG_SYNCWORD);
-                for(int i = 0; i < 16; i++) {
-                    if(it != msgwords.end()) {
-                        queue(*it);
-                        it++;
-                    } else {
-                        queue(POCSAG_IDLEWORD);
-                    }
-                }
-            }
-        }
-
-        void
-        pocencode_impl::queue(shared_ptr<bvec> bvptr) {
-            for(unsigned int i = 0; i < bvptr->size(); i++) {
-                queuebit((*bvptr)[i]);
+        /**
+         * Encode a page and queue it after whatever is already queued.
+         * Returns false (with the reason logged) if it can't be encoded.
+         */
+        bool
+        pocencode_impl::queue_batch(int msgtype, unsigned int capcode, const std::string &message) {
+            core::page pg;
+            pg.protocol = d_protocol;
+            pg.type = (core::msgtype_t)msgtype;
+            pg.capcodes.push_back(capcode);
+            pg.message = message;
+            core::encoded_page encoded;
+            string error;
+            if(msgtype != Alpha && msgtype != Numeric && msgtype != Auto) {
+                error = "Invalid message type specified.";
+            } else if(core::encode(pg, encoded, &error)) {
+                d_queue.push(transmission::from_bits(std::move(encoded.bits), encoded.nbits, d_baudrate));
+                return true;
             }
+            d_logger->warn("can't encode page for capcode {}: {}", capcode, error);
+            return false;
         }
-        void
-        pocencode_impl::queue(uint32_t val) {
-            for(int i = 0; i < 32; i++) {
-                queuebit(((val & 0x80000000) == 0x80000000) ? 1 : 0);
-                val = val << 1;
-            }
-        }
-
 
-
-        pocencode_impl::pocencode_impl(int msgtype, unsigned int baudrate, unsigned int capcode, std::string message, unsigned long symrate)
-          : d_baudrate(baudrate), d_capcode(capcode), d_msgtype(msgtype), d_message(message), d_symrate(symrate),
-          sync_block("pocencode",
+        pocencode_impl::pocencode_impl(int msgtype, unsigned int baudrate, unsigned int capcode, std::string message, unsigned long symrate, bool persistent)
+          : sync_block("pocencode",
                   io_signature::make(0, 0, 0),
-                  io_signature::make(1, 1, sizeof (unsigned char)))
+                  io_signature::make(1, 1, sizeof (unsigned char))),
+          d_msgtype(msgtype), d_baudrate(baudrate), d_capcode(capcode), d_symrate(symrate), d_message(message), d_persistent(persistent), d_queue(symrate)
         {
             if(d_symrate % d_baudrate != 0) {
-                std::cerr << "Output symbol rate must be evenly divisible by baud rate!" << std::endl;
+                d_logger->error("Output symbol rate must be evenly divisible by baud rate!");
                 throw std::runtime_error("Output symbol rate is not evenly divisible by baud rate");
             }
-            queue_batch();
+            switch(d_baudrate) {
+                case 512:
+                    d_protocol = core::POCSAG512;
+                    break;
+                case 2400:
+                    d_protocol = core::POCSAG2400;
+                    break;
+                default:
+                    // Other rates work too; the encoding is the same.
+                    d_protocol = core::POCSAG1200;
+                    break;
+            }
+            // In persistent mode the constructor's page is optional.
+            if(!d_persistent || !d_message.empty()) {
+                if(!queue_batch(d_msgtype, d_capcode, d_message)) {
+                    throw std::runtime_error("can't encode the page");
+                }
+            }
+            message_port_register_in(pmt::mp("pages"));
+            set_msg_handler(pmt::mp("pages"), [this](pmt::pmt_t msg) { this->page_message(msg); });
         }
 
-        // Insert bits into the queue.  Here is also where we repeat a single bit
-        // so that we're emitting d_symrate symbols per second.
-        inline void
-        pocencode_impl::queuebit(bool bit) {
-            const unsigned int interp = d_symrate / d_baudrate;
-            for(unsigned int i = 0; i < interp; i++) {
-                d_bitqueue.push(bit);
+        /**
+         * A page to send after whatever is queued.  Capcode and message type
+         * default to the block's parameters (see page_from_pdu()).
+         */
+        void
+        pocencode_impl::page_message(pmt::pmt_t msg) {
+            int msgtype = d_msgtype;
+            unsigned int capcode = d_capcode;
+            string message;
+            if(!page_from_pdu(msg, msgtype, capcode, message)) {
+                d_logger->warn("pages: got invalid page: {}", pmt::write_string(msg));
+                return;
             }
+            boost::mutex::scoped_lock lock(d_mutex);
+            queue_batch(msgtype, capcode, message);
         }
 
         pocencode_impl::~pocencode_impl()
         {
         }
 
-        // Move data from our internal queue (d_bitqueue) out to gnuradio.  Here
-        // we also convert our data from bits (0 and 1) to symbols (1 and -1).
+        // Move data from our internal queue (d_queue) out to gnuradio.  Here
+        // each bit is repeated to the output rate and converted to a symbol (1 or -1).
         //
         // These symbols are then used by the FM block to generate signals that are
         // +/- the max deviation.  (For POCSAG, that deviation is 4500 Hz.)  All of
@@ -153,29 +127,12 @@ namespace gr {
             //const float *in = (const float *) input_items[0];
             unsigned char *out = (unsigned char *) output_items[0];
 
-            if(d_bitqueue.empty()) {
-                return -1;
-            }
-            const int toxfer = noutput_items < d_bitqueue.size() ? noutput_items : d_bitqueue.size();
-            assert(toxfer >= 0);
-            for(int i = 0; i < toxfer ; i++) {
-                const bool bbit = d_bitqueue.front();
-                switch((int)bbit) {
-                    case 0:
-                        out[i] = 1;
-                        break;
-                    case 1:
-                        out[i] = -1;
-                        break;
-                    default:
-                        std::cout << "invalid value in bitqueue" << std::endl;
-                        abort();
-                        break;
-                }
-                d_bitqueue.pop();
+            boost::mutex::scoped_lock lock(d_mutex);
+            if(d_queue.empty()) {
+                // One-shot mode is done; persistent mode waits for the next page.
+                return d_persistent ? 0 : -1;
             }
-            return toxfer;
-
+            return d_queue.read(out, noutput_items);
         }
     } /* namespace mixalot */
 } /* namespace gr */
@@ -8,10 +8,9 @@
 #define INCLUDED_MIXALOT_POCENCODE_IMPL_H
 
 #include <gnuradio/mixalot/pocencode.h>
-#include <queue>
-#include <itpp/comm/bch.h>
+#include <gnuradio/mixalot/core.h>
+#include "transmission.h"
 
-using namespace itpp;
 using std::string;
 using std::shared_ptr;
 
@@ -22,23 +21,24 @@ namespace gr {
     class pocencode_impl : public pocencode
     {
     private:
-        std::queue<bool> d_bitqueue;   // Queue of symbols to be sent out.
         int d_msgtype;                // message type
         unsigned int d_baudrate;            // baud rate to transmit at -- should be 512, 1200, or 2400 (although others will work!)
+        core::protocol_t d_protocol;        // encoder for d_baudrate
         unsigned int d_capcode;             // capcode (pager ID)
         unsigned long d_symrate;            // output symbol rate (must be evenly divisible by the baud rate)
         std::string d_message;              // message to send
+        bool d_persistent;                  // keep running, waiting for pages, when the queue is empty
+        transmission_queue d_queue;         // Encoded pages to be sent out
+        boost::mutex d_mutex;               // guards d_queue
 
-        inline void queuebit(bool bit);
 
     public:
-      pocencode_impl(int msgtype, unsigned int baudrate, unsigned int capcode, std::string message, unsigned long symrate);
+      pocencode_impl(int msgtype, unsigned int baudrate, unsigned int capcode, std::string message, unsigned long symrate, bool persistent);
       ~pocencode_impl();
 
       // Where all the action really happens
-        void queue_batch();
-        void queue(shared_ptr<bvec> bvptr);
-        void queue(uint32_t val);
+        void page_message(pmt::pmt_t msg);
+        bool queue_batch(int msgtype, unsigned int capcode, const std::string &message);
         int work(int noutput_items,
            gr_vector_const_void_star &input_items,
            gr_vector_void_star &output_items);
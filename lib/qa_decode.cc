@@ -0,0 +1,361 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+// Loopback tests for the decoders: encode a page with each encoder block,
+// decode the output (cleanly, with correctable errors added, and with
+// random garbage), and check what comes back.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "flexencode_impl.h"
+#include "pocencode_impl.h"
+#include "gscencode_impl.h"
+#include "pagerdecode_impl.h"
+#include "utils.h"
+#include <gnuradio/mixalot/core.h>
+
+using namespace gr::mixalot;
+
+static const unsigned long symrate = 38400;
+static const std::string numeric_msg = "0123456789 U-[]";
+static const std::string alpha_msg = "HACK THE PLANET. The quick brown fox jumps over the lazy dog 0123456789";
+// GSC has a 64-character set (upper case only).
+static const std::string gsc_msg = "HACK THE PLANET. THE QUICK BROWN FOX 0123456789";
+
+static std::vector<unsigned char>
+drain(gr::sync_block &blk) {
+    std::vector<unsigned char> out;
+    std::vector<unsigned char> buf(4096);
+    gr_vector_const_void_star input_items;
+    gr_vector_void_star output_items(1, &buf[0]);
+    for(;;) {
+        const int ret = blk.work(buf.size(), input_items, output_items);
+        if(ret <= 0) {
+            break;
+        }
+        out.insert(out.end(), buf.begin(), buf.begin() + ret);
+    }
+    return out;
+}
+
+// One bit per symbol: 1 for a positive symbol.
+static std::vector<uint8_t>
+to_bits(const std::vector<unsigned char> &syms, unsigned int interp) {
+    std::vector<uint8_t> bits;
+    for(size_t i = 0; i < syms.size(); i += interp) {
+        bits.push_back((signed char)syms[i] > 0 ? 1 : 0);
+    }
+    return bits;
+}
+
+static std::vector<decoded_page>
+decode_bits(const std::string &protocol, const std::vector<uint8_t> &bits) {
+    std::vector<uint8_t> packed((bits.size() + 7) / 8, 0);
+    for(size_t i = 0; i < bits.size(); i++) {
+        if(bits[i]) {
+            packed[i / 8] |= 0x80 >> (i % 8);
+        }
+    }
+    return decode_packed_bits(protocol, &packed[0], bits.size());
+}
+
+static std::vector<unsigned char>
+flexencode_page(const std::string &cmd) {
+    flexencode_impl blk(0, 0, 0, std::vector<double>(1, 931337500), 0, 0, "", 0, "", 0, 0, 0, false);
+    blk.beeps_message(pmt::cons(pmt::make_dict(), pmt::init_u8vector(cmd.length(), (const uint8_t *)cmd.c_str())));
+    return drain(blk);
+}
+
+static std::string
+hex_encode(const std::string &s) {
+    std::string hex;
+    for(size_t i = 0; i < s.length(); i++) {
+        char buf[3];
+        snprintf(buf, sizeof(buf), "%02x", (unsigned char)s[i]);
+        hex += buf;
+    }
+    return hex;
+}
+
+// Flip nflips bits in every period-bit span after offset.
+static void
+add_errors(std::vector<uint8_t> &bits, size_t offset, size_t period, unsigned int nflips, unsigned int seed) {
+    std::mt19937 rng(seed);
+    for(size_t start = offset; start + period <= bits.size(); start += period) {
+        std::uniform_int_distribution<size_t> pos(0, period - 1);
+        std::vector<size_t> done;
+        while(done.size() < nflips) {
+            const size_t p = pos(rng);
+            if(std::find(done.begin(), done.end(), p) == done.end()) {
+                done.push_back(p);
+                bits[start + p] ^= 1;
+            }
+        }
+    }
+}
+
+static void
+check_page(const std::vector<decoded_page> &pages, uint32_t capcode, const std::string &type, const std::string &msg) {
+    BOOST_REQUIRE_EQUAL(pages.size(), 1u);
+    BOOST_CHECK_EQUAL(pages[0].capcode, capcode);
+    BOOST_CHECK_EQUAL(pages[0].type, type);
+    BOOST_CHECK_EQUAL(pages[0].message, msg);
+    BOOST_CHECK_EQUAL(pages[0].uncorrectable, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(decode_pocsag)
+{
+    const unsigned int bauds[] = { 512, 1200, 2400 };
+    for(unsigned int baud : bauds) {
+        const std::string proto = "pocsag" + std::to_string(baud);
+        pocencode_impl num(pocencode::Numeric, baud, 1234567, numeric_msg, symrate, false);
+        std::vector<uint8_t> bits = to_bits(drain(num), symrate / baud);
+        check_page(decode_bits(proto, bits), 1234567, "numeric", numeric_msg);
+
+        pocencode_impl alpha(pocencode::Alpha, baud, 1615132, alpha_msg, symrate, false);
+        bits = to_bits(drain(alpha), symrate / baud);
+        check_page(decode_bits(proto, bits), 1615132, "alpha", alpha_msg);
+
+        // Two bit errors in every codeword after the preamble (576 bits).
+        add_errors(bits, 576, 32, 2, baud);
+        const std::vector<decoded_page> pages = decode_bits(proto, bits);
+        check_page(pages, 1615132, "alpha", alpha_msg);
+        BOOST_CHECK(pages[0].corrected > 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(decode_flexencode_pocsag)
+{
+    const std::vector<uint8_t> bits = to_bits(
+            flexencode_page("pocsag1200 0 931337500 alpha 1615132 " + hex_encode(alpha_msg)), symrate / 1200);
+    check_page(decode_bits("pocsag1200", bits), 1615132, "alpha", alpha_msg);
+}
+
+BOOST_AUTO_TEST_CASE(decode_flexencode_pocsag_group)
+{
+    // One command to several capcodes (two of them in the same frame) is
+    // one transmission, acked once, that every pager decodes.
+    const uint32_t codes[] = { 1615132, 1234567, 1615124, 8 };
+    const std::string cmd = "pocsag1200 grp 931337500 alpha 1615132,1234567,1615124,8 " + hex_encode(alpha_msg);
+    flexencode_impl blk(0, 0, 0, std::vector<double>(1, 931337500), 0, 0, "", 0, "", 0, 0, 0, false);
+    blk.beeps_message(pmt::cons(pmt::make_dict(), pmt::init_u8vector(cmd.length(), (const uint8_t *)cmd.c_str())));
+    BOOST_CHECK_EQUAL(blk.pages_accepted(), 1);
+    const std::vector<unsigned char> syms = drain(blk);
+
+    std::vector<decoded_page> pages = decode_bits("pocsag1200", to_bits(syms, symrate / 1200));
+    BOOST_REQUIRE_EQUAL(pages.size(), 4u);
+    std::vector<uint32_t> got;
+    for(const auto &page : pages) {
+        BOOST_CHECK_EQUAL(page.type, "alpha");
+        BOOST_CHECK_EQUAL(page.message, alpha_msg);
+        got.push_back(page.capcode);
+    }
+    std::sort(got.begin(), got.end());
+    std::vector<uint32_t> want(codes, codes + 4);
+    std::sort(want.begin(), want.end());
+    BOOST_CHECK(got == want);
+
+    // Shorter than four separate pages: one preamble.
+    size_t separate = 0;
+    for(uint32_t code : codes) {
+        separate += flexencode_page("pocsag1200 0 931337500 alpha " + std::to_string(code) + " " + hex_encode(alpha_msg)).size();
+    }
+    BOOST_CHECK_LT(syms.size(), separate);
+
+    // Repeated capcodes are sent once.
+    core::page pg;
+    pg.protocol = core::POCSAG1200;
+    pg.type = core::Alpha;
+    pg.message = alpha_msg;
+    pg.capcodes.assign(2, 1615132);
+    core::encoded_page twice, once;
+    BOOST_REQUIRE(core::encode(pg, twice));
+    pg.capcodes.resize(1);
+    BOOST_REQUIRE(core::encode(pg, once));
+    BOOST_CHECK(twice.bits == once.bits);
+    check_page(decode_packed_bits("pocsag1200", &twice.bits[0], twice.nbits), 1615132, "alpha", alpha_msg);
+}
+
+BOOST_AUTO_TEST_CASE(decode_flex)
+{
+    std::vector<uint8_t> bits = to_bits(
+            flexencode_page("flex 0 931337500 numeric 1337000 " + hex_encode(numeric_msg)), symrate / 1600);
+    check_page(decode_bits("flex", bits), 1337000, "numeric", numeric_msg);
+
+    bits = to_bits(flexencode_page("flex 0 931337500 alpha 1337000 " + hex_encode(alpha_msg)), symrate / 1600);
+    check_page(decode_bits("flex", bits), 1337000, "alpha", alpha_msg);
+
+    // The blocks are interleaved, so a burst of 8 consecutive bits is at
+    // most one error in each of the block's codewords.
+    const size_t blocks = bits.size() - 11 * 256;
+    for(size_t b = 0; b < 11; b++) {
+        for(size_t i = 0; i < 8; i++) {
+            bits[blocks + b * 256 + 100 + i] ^= 1;
+        }
+    }
+    const std::vector<decoded_page> pages = decode_bits("flex", bits);
+    check_page(pages, 1337000, "alpha", alpha_msg);
+    BOOST_CHECK(pages[0].corrected > 0);
+}
+
+BOOST_AUTO_TEST_CASE(decode_flex_max_alpha)
+{
+    // The longest alpha message that fits in a frame, and one character
+    // more, which has to be refused rather than overrun the message buffer.
+    core::page pg;
+    pg.protocol = core::FLEX;
+    pg.type = core::Alpha;
+    pg.capcodes.push_back(1337000);
+    while(pg.message.length() < 251) {
+        pg.message += alpha_msg;
+    }
+    pg.message.resize(251);
+    core::encoded_page out;
+    std::string error;
+    BOOST_REQUIRE_MESSAGE(core::encode(pg, out, &error), error);
+    check_page(decode_packed_bits("flex", &out.bits[0], out.nbits), 1337000, "alpha", pg.message);
+
+    pg.message += "x";
+    BOOST_CHECK(!core::encode(pg, out, &error));
+}
+
+BOOST_AUTO_TEST_CASE(decode_flex_multi_capcode)
+{
+    // One vector word is sent for all the capcodes of a page, with the
+    // message right after it; every capcode still gets the page.
+    const uint32_t codes[] = { 1337000, 1234567, 200000, 1900000 };
+    const char *types[] = { "numeric", "alpha" };
+    for(const char *type : types) {
+        core::page pg;
+        pg.protocol = core::FLEX;
+        pg.type = std::string(type) == "alpha" ? core::Alpha : core::Numeric;
+        pg.capcodes.assign(codes, codes + 4);
+        pg.message = pg.type == core::Alpha ? alpha_msg : numeric_msg;
+        core::encoded_page out;
+        std::string error;
+        BOOST_REQUIRE_MESSAGE(core::encode(pg, out, &error), error);
+        const std::vector<decoded_page> pages = decode_packed_bits("flex", &out.bits[0], out.nbits);
+        BOOST_REQUIRE_EQUAL(pages.size(), 4u);
+        for(size_t i = 0; i < pages.size(); i++) {
+            BOOST_CHECK_EQUAL(pages[i].capcode, codes[i]);
+            BOOST_CHECK_EQUAL(pages[i].type, type);
+            BOOST_CHECK_EQUAL(pages[i].message, pg.message);
+            BOOST_CHECK_EQUAL(pages[i].uncorrectable, 0u);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(decode_gsc)
+{
+    gscencode_impl alpha(gscencode::Alpha, 123456, gsc_msg, symrate, false);
+    const std::vector<uint8_t> bits = to_bits(drain(alpha), symrate / 600);
+    check_page(decode_bits("gsc", bits), 123456, "alpha", gsc_msg);
+
+    gscencode_impl numeric(gscencode::Numeric, 123456, "0123456789 U-=E", symrate, false);
+    check_page(decode_bits("gsc", to_bits(drain(numeric), symrate / 600)), 123456, "numeric", "0123456789 U-=E");
+
+    const uint32_t capcodes[] = { 1, 999, 50123, 987654, 424242 };
+    for(uint32_t capcode : capcodes) {
+        gscencode_impl page(gscencode::Alpha, capcode, "TEST", symrate, false);
+        check_page(decode_bits("gsc", to_bits(drain(page), symrate / 600)), capcode, "alpha", "TEST");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(decode_noise)
+{
+    // Random bits shouldn't produce pages (or crash).
+    std::mt19937 rng(1);
+    std::vector<uint8_t> bits(200000);
+    for(auto &b : bits) {
+        b = rng() & 1;
+    }
+    const char *protocols[] = { "pocsag512", "pocsag1200", "pocsag2400", "flex", "gsc" };
+    for(const char *proto : protocols) {
+        decode_bits(proto, bits);
+    }
+    BOOST_CHECK(decode_bits("nonsense", bits).empty());
+}
+
+BOOST_AUTO_TEST_CASE(decode_encodewords)
+{
+    // The batch encoder (whichever version this CPU gets) agrees with
+    // encodeword(), for any length and alignment, and its code words decode
+    // cleanly.
+    std::mt19937 rng(45);
+    std::vector<uint32_t> in(1037);
+    for(auto &w : in) {
+        w = rng();
+    }
+    const size_t lengths[] = { 0, 1, 7, 8, 9, 31, 1000, 1036 };
+    for(size_t n : lengths) {
+        std::vector<uint32_t> out(n + 1, 0xdeadbeef);
+        encodewords(&in[1], &out[0], n);
+        for(size_t i = 0; i < n; i++) {
+            BOOST_REQUIRE_EQUAL(out[i], encodeword(in[i + 1]));
+            uint32_t corrected;
+            unsigned int nerrors;
+            BOOST_REQUIRE(decodeword(out[i], corrected, nerrors));
+            BOOST_REQUIRE_EQUAL(nerrors, 0u);
+        }
+        BOOST_CHECK_EQUAL(out[n], 0xdeadbeefu);
+    }
+    std::vector<uint32_t> inplace(in);
+    encodewords(inplace.data(), inplace.data(), inplace.size());
+    for(size_t i = 0; i < in.size(); i++) {
+        BOOST_REQUIRE_EQUAL(inplace[i], encodeword(in[i]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(decode_block)
+{
+    // The whole block, fed the symbol stream in uneven chunks, with every
+    // decoder running.
+    pagerdecode_impl blk(symrate, true, true, true);
+    std::vector<unsigned char> syms = flexencode_page("flex 0 931337500 alpha 1337000 " + hex_encode(alpha_msg));
+    pocencode_impl num(pocencode::Numeric, 1200, 1234567, numeric_msg, symrate, false);
+    const std::vector<unsigned char> pocsag = drain(num);
+    syms.insert(syms.end(), pocsag.begin(), pocsag.end());
+
+    gr_vector_void_star output_items;
+    for(size_t pos = 0; pos < syms.size(); ) {
+        const size_t n = std::min<size_t>(syms.size() - pos, 1000 + pos % 777);
+        gr_vector_const_void_star input_items(1, &syms[pos]);
+        BOOST_REQUIRE_EQUAL(blk.work(n, input_items, output_items), (int)n);
+        pos += n;
+    }
+    blk.stop();
+    BOOST_CHECK_EQUAL(blk.pages_decoded(), 2);
+    BOOST_CHECK_EQUAL(blk.uncorrectable_words(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(decode_persistent)
+{
+    // Persistent encoders with no initial page idle (return 0, not -1) until
+    // pages arrive on the message port.
+    pocencode_impl poc(pocencode::Numeric, 1200, 0, "", symrate, true);
+    BOOST_CHECK(drain(poc).empty());
+    pmt::pmt_t meta = pmt::make_dict();
+    meta = pmt::dict_add(meta, pmt::mp("capcode"), pmt::from_long(1615132));
+    meta = pmt::dict_add(meta, pmt::mp("type"), pmt::mp("alpha"));
+    poc.page_message(pmt::cons(meta, pmt::init_u8vector(alpha_msg.length(), (const uint8_t *)alpha_msg.c_str())));
+    check_page(decode_bits("pocsag1200", to_bits(drain(poc), symrate / 1200)), 1615132, "alpha", alpha_msg);
+    // Defaults come from the block's parameters.
+    poc.page_message(pmt::cons(pmt::make_dict(), pmt::init_u8vector(numeric_msg.length(), (const uint8_t *)numeric_msg.c_str())));
+    check_page(decode_bits("pocsag1200", to_bits(drain(poc), symrate / 1200)), 0, "numeric", numeric_msg);
+
+    gscencode_impl gsc(gscencode::Alpha, 123456, gsc_msg, symrate, true);
+    check_page(decode_bits("gsc", to_bits(drain(gsc), symrate / 600)), 123456, "alpha", gsc_msg);
+    meta = pmt::dict_add(pmt::make_dict(), pmt::mp("capcode"), pmt::from_long(987654));
+    gsc.page_message(pmt::cons(meta, pmt::init_u8vector(4, (const uint8_t *)"TEST")));
+    check_page(decode_bits("gsc", to_bits(drain(gsc), symrate / 600)), 987654, "alpha", "TEST");
+}
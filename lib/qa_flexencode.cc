@@ -0,0 +1,233 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+// Behaviour tests for the flexencode PDU server: scheduled pages,
+// duplicates, cancelling and TTLs, per-channel acks and the journal.  What
+// goes out is checked against the same pages sent on their own, so the bits
+// themselves are left to qa_golden.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <boost/test/unit_test.hpp>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include "flexencode_impl.h"
+
+using namespace gr::mixalot;
+
+static const std::string numeric_msg = "0123456789 U-[]";
+static const std::string alpha_msg = "HACK THE PLANET. The quick brown fox jumps over the lazy dog 0123456789";
+
+// A flexencode with no admission limits.  The default is a single-entry
+// channel map, so the block never needs to tag a retune (which would
+// require a running flowgraph).
+static std::unique_ptr<flexencode_impl>
+make_block(const std::vector<double> &freqs = std::vector<double>(1, 931337500),
+        const std::string &journal = "", double dedup_window = 0) {
+    return std::unique_ptr<flexencode_impl>(
+            new flexencode_impl(0, 0, 0, freqs, 0, 0, "", 0, journal, 0, 0, dedup_window, false));
+}
+
+// Send a command to the block as if it had arrived on the "beeps" port.
+static void
+send_command(flexencode_impl &blk, const std::string &cmd) {
+    blk.beeps_message(pmt::cons(pmt::make_dict(), pmt::init_u8vector(cmd.length(), (const uint8_t *)cmd.c_str())));
+}
+
+static uint64_t
+stat_value(flexencode_impl &blk, const char *name) {
+    return pmt::to_uint64(pmt::dict_ref(blk.stats(), pmt::mp(name), pmt::PMT_NIL));
+}
+
+// Run work() until the block has nothing more to send, collecting output.
+static std::vector<unsigned char>
+drain(gr::sync_block &blk) {
+    std::vector<unsigned char> out;
+    std::vector<unsigned char> buf(4096);
+    gr_vector_const_void_star input_items;
+    gr_vector_void_star output_items(1, &buf[0]);
+    for(;;) {
+        const int ret = blk.work(buf.size(), input_items, output_items);
+        if(ret <= 0) {
+            break;
+        }
+        out.insert(out.end(), buf.begin(), buf.begin() + ret);
+    }
+    return out;
+}
+
+// Send one command to a fresh flexencode and collect the page it produces.
+static std::vector<unsigned char>
+flexencode_page(const std::string &cmd) {
+    std::unique_ptr<flexencode_impl> blk = make_block();
+    send_command(*blk, cmd);
+    return drain(*blk);
+}
+
+static std::string
+hex_encode(const std::string &s) {
+    std::string hex;
+    for(size_t i = 0; i < s.length(); i++) {
+        char buf[3];
+        snprintf(buf, sizeof(buf), "%02x", (unsigned char)s[i]);
+        hex += buf;
+    }
+    return hex;
+}
+
+BOOST_AUTO_TEST_CASE(flexencode_sendin)
+{
+    // Scheduled pages come out exactly as if they'd been sent when they fell
+    // due: one already past, one a little later, one not for an hour.
+    const std::string soon = "flex 0 931337500 alpha 1337000 " + hex_encode(alpha_msg);
+    const std::string past = "pocsag1200 1 931337500 numeric 1234560 " + hex_encode(numeric_msg);
+    std::vector<unsigned char> expected = flexencode_page(past);
+    const std::vector<unsigned char> second = flexencode_page(soon);
+    expected.insert(expected.end(), second.begin(), second.end());
+
+    // The scheduler runs off a clock the test moves on by hand.
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::unique_ptr<flexencode_impl> blk = make_block();
+    blk->set_clock([&now] { return now; });
+    for(const std::string &cmd : { "sendin 0.2 " + soon, "sendat 1 " + past,
+            "sendin 3600 " + soon, "sendin soon " + soon }) {
+        send_command(*blk, cmd);
+    }
+    BOOST_CHECK_EQUAL(blk->pages_rejected(), 1);
+    BOOST_CHECK_EQUAL(stat_value(*blk, "scheduled_pages"), 3u);
+    BOOST_CHECK_EQUAL(blk->pages_accepted(), 0);
+
+    now += std::chrono::milliseconds(100);
+    blk->run_scheduled();
+    BOOST_CHECK_EQUAL(stat_value(*blk, "scheduled_pages"), 2u);
+    BOOST_CHECK_EQUAL(blk->pages_accepted(), 1);
+
+    now += std::chrono::milliseconds(150);
+    blk->run_scheduled();
+    BOOST_CHECK_EQUAL(stat_value(*blk, "scheduled_pages"), 1u);
+    BOOST_CHECK_EQUAL(blk->pages_accepted(), 2);
+    const std::vector<unsigned char> got = drain(*blk);
+    BOOST_REQUIRE_EQUAL(got.size(), expected.size());
+    BOOST_CHECK(got == expected);
+}
+
+BOOST_AUTO_TEST_CASE(flexencode_drop)
+{
+    // A retry of a page already queued is turned away; a cancelled page and
+    // one whose TTL runs out before it goes on the air never go out, and
+    // the cancelled one can be sent again.  The same capcode and message on
+    // another protocol is another page.  What does go out is unchanged.
+    const std::string first = "flex 0 931337500 alpha 1337000 " + hex_encode(alpha_msg);
+    const std::string other = " 931337500 numeric 1337001 " + hex_encode(numeric_msg);
+    const std::string pocsag = "pocsag1200 5 931337500 alpha 1337000 " + hex_encode(alpha_msg);
+    std::vector<unsigned char> expected = flexencode_page(first);
+    const std::vector<unsigned char> second = flexencode_page("flex 4" + other);
+    expected.insert(expected.end(), second.begin(), second.end());
+    const std::vector<unsigned char> third = flexencode_page(pocsag);
+    expected.insert(expected.end(), third.begin(), third.end());
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::unique_ptr<flexencode_impl> blk = make_block(std::vector<double>(1, 931337500), "", 60);
+    blk->set_clock([&now] { return now; });
+    for(const std::string &cmd : { first, "flex 1 931337500 alpha 1337000 " + hex_encode(alpha_msg),
+            "flex 2" + other, "flex 3 931337500 alpha 1337002 " + hex_encode(alpha_msg) + " ttl=0.05",
+            std::string("cancel 2"), std::string("cancel 9"), "flex 4" + other, pocsag }) {
+        send_command(*blk, cmd);
+    }
+    now += std::chrono::milliseconds(100);
+    const std::vector<unsigned char> got = drain(*blk);
+    BOOST_CHECK_EQUAL(stat_value(*blk, "rejected_duplicate"), 1u);
+    BOOST_CHECK_EQUAL(stat_value(*blk, "rejected_invalid"), 1u);
+    BOOST_CHECK_EQUAL(stat_value(*blk, "pages_cancelled"), 1u);
+    BOOST_CHECK_EQUAL(stat_value(*blk, "pages_expired"), 1u);
+    BOOST_CHECK_EQUAL(stat_value(*blk, "queued_pages"), 0u);
+    BOOST_REQUIRE_EQUAL(got.size(), expected.size());
+    BOOST_CHECK(got == expected);
+}
+
+BOOST_AUTO_TEST_CASE(flexencode_channel_ack)
+{
+    // A short page on one channel is acked when it's done, while a long
+    // one is still going out on the other.
+    std::vector<double> freqs;
+    freqs.push_back(931337500);
+    freqs.push_back(931937500);
+    std::unique_ptr<flexencode_impl> blk = make_block(freqs);
+    std::vector<std::string> replies;
+    blk->set_output_hook([&replies](const std::string &msg) { replies.push_back(msg); });
+    send_command(*blk, "pocsag512 0 931337500 alpha 1615132 " + hex_encode(alpha_msg + alpha_msg));
+    send_command(*blk, "flex 1 931937500 numeric 1337000 " + hex_encode(numeric_msg));
+    const size_t flex_len = flexencode_page("flex 1 931337500 numeric 1337000 " + hex_encode(numeric_msg)).size();
+    std::vector<unsigned char> out0(flex_len), out1(flex_len);
+    gr_vector_const_void_star input_items;
+    gr_vector_void_star output_items;
+    output_items.push_back(&out0[0]);
+    output_items.push_back(&out1[0]);
+    BOOST_CHECK(replies.empty());
+    BOOST_REQUIRE_EQUAL(blk->work(flex_len, input_items, output_items), (int)flex_len);
+    BOOST_CHECK(std::find(replies.begin(), replies.end(), "1 OK\n") != replies.end());
+    BOOST_CHECK(std::find(replies.begin(), replies.end(), "0 OK\n") == replies.end());
+    BOOST_CHECK(blk->queued_samples() > 0);
+    BOOST_CHECK_EQUAL(stat_value(*blk, "queued_pages"), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(flexencode_journal)
+{
+    // A page accepted but never sent is sent again, unchanged, by the next
+    // encoder on the same journal; once it's acked it's gone.
+    char dir[] = "/tmp/mixalot_qa_XXXXXX";
+    BOOST_REQUIRE(mkdtemp(dir) != NULL);
+    const std::string journal = std::string(dir) + "/journal";
+    const std::vector<double> freqs(1, 931337500);
+    const std::string cmd = "flex 0 931337500 alpha 1337000 " + hex_encode(alpha_msg);
+    const std::vector<unsigned char> expected = flexencode_page(cmd);
+    {
+        std::unique_ptr<flexencode_impl> blk = make_block(freqs, journal);
+        blk->start();
+        send_command(*blk, cmd);
+    }
+    {
+        std::unique_ptr<flexencode_impl> blk = make_block(freqs, journal);
+        blk->start();
+        BOOST_CHECK(drain(*blk) == expected);
+        BOOST_CHECK_EQUAL(stat_value(*blk, "journal_pending"), 0u);
+    }
+    {
+        std::unique_ptr<flexencode_impl> blk = make_block(freqs, journal);
+        blk->start();
+        BOOST_CHECK(drain(*blk).empty());
+    }
+
+    // A page is acked, and finished in the journal, as soon as it has gone
+    // out, so it isn't sent again.
+    {
+        std::unique_ptr<flexencode_impl> blk = make_block(freqs, journal);
+        blk->start();
+        send_command(*blk, cmd);
+        std::vector<unsigned char> buf(1 << 20);
+        gr_vector_const_void_star input_items;
+        gr_vector_void_star output_items(1, &buf[0]);
+        BOOST_REQUIRE(blk->work(buf.size(), input_items, output_items) > 0);
+        BOOST_CHECK_EQUAL(stat_value(*blk, "journal_pending"), 0u);
+    }
+    {
+        std::unique_ptr<flexencode_impl> blk = make_block(freqs, journal);
+        blk->start();
+        BOOST_CHECK_EQUAL(stat_value(*blk, "journal_pending"), 0u);
+        BOOST_CHECK(drain(*blk).empty());
+    }
+
+    unlink(journal.c_str());
+    rmdir(dir);
+}
@@ -0,0 +1,329 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+// Golden-vector regression tests.  Each case encodes one page, reduces the
+// block's output back to one bit per transmitted symbol, and compares the
+// packed bits against lib/golden/<case>.hex.  Any change to the encoders
+// (BCH, interleaving, the symbol queues...) has to keep these bit-identical.
+//
+// To regenerate the golden files after an intentional change to the
+// transmitted bits, run with MIXALOT_UPDATE_GOLDEN=1 in the environment and
+// check the diff carefully.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <boost/test/unit_test.hpp>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "flexencode_impl.h"
+#include "pocencode_impl.h"
+#include "gscencode_impl.h"
+#include <gnuradio/mixalot/core.h>
+#include <gnuradio/mixalot/render.h>
+
+using namespace gr::mixalot;
+
+#ifndef GOLDEN_DIR
+#define GOLDEN_DIR "golden"
+#endif
+
+static const unsigned long symrate = 38400;
+static const std::string numeric_msg = "0123456789 U-[]";
+static const std::string alpha_msg = "HACK THE PLANET. The quick brown fox jumps over the lazy dog 0123456789";
+
+// Run work() until the block has nothing more to send, collecting output.
+static std::vector<unsigned char>
+drain(gr::sync_block &blk) {
+    std::vector<unsigned char> out;
+    std::vector<unsigned char> buf(4096);
+    gr_vector_const_void_star input_items;
+    gr_vector_void_star output_items(1, &buf[0]);
+    for(;;) {
+        const int ret = blk.work(buf.size(), input_items, output_items);
+        if(ret <= 0) {
+            break;
+        }
+        out.insert(out.end(), buf.begin(), buf.begin() + ret);
+    }
+    return out;
+}
+
+// Reduce symbols (1 and -1, each repeated interp times) to bits, packed
+// MSB first.  Every symbol has to be repeated exactly interp times.
+static std::vector<uint8_t>
+pack_bits(const std::vector<unsigned char> &syms, unsigned int interp, size_t &nbits) {
+    BOOST_REQUIRE_EQUAL(syms.size() % interp, 0u);
+    nbits = syms.size() / interp;
+    std::vector<uint8_t> packed((nbits + 7) / 8, 0);
+    for(size_t i = 0; i < nbits; i++) {
+        const unsigned char s = syms[i * interp];
+        BOOST_REQUIRE(s == 1 || s == 0xff);
+        for(unsigned int j = 1; j < interp; j++) {
+            BOOST_REQUIRE_EQUAL(syms[i * interp + j], s);
+        }
+        if(s == 1) {
+            packed[i / 8] |= 0x80 >> (i % 8);
+        }
+    }
+    return packed;
+}
+
+static std::string
+to_hex(const std::vector<uint8_t> &packed, size_t nbits) {
+    std::ostringstream ss;
+    ss << "bits " << nbits << "\n";
+    for(size_t i = 0; i < packed.size(); i++) {
+        char buf[3];
+        snprintf(buf, sizeof(buf), "%02x", packed[i]);
+        ss << buf;
+        if(i % 32 == 31 || i == packed.size() - 1) {
+            ss << "\n";
+        }
+    }
+    return ss.str();
+}
+
+static void
+check_golden(const std::string &name, const std::vector<unsigned char> &syms, unsigned int interp) {
+    size_t nbits;
+    const std::vector<uint8_t> packed = pack_bits(syms, interp, nbits);
+    BOOST_REQUIRE(nbits > 0);
+    const std::string got = to_hex(packed, nbits);
+    const std::string path = std::string(GOLDEN_DIR) + "/" + name + ".hex";
+
+    if(getenv("MIXALOT_UPDATE_GOLDEN") != NULL) {
+        std::ofstream f(path.c_str());
+        f << got;
+        BOOST_REQUIRE(f.good());
+        BOOST_TEST_MESSAGE("updated " << path);
+        return;
+    }
+    std::ifstream f(path.c_str());
+    BOOST_REQUIRE_MESSAGE(f.good(), "can't read " << path);
+    std::stringstream expected;
+    expected << f.rdbuf();
+    BOOST_CHECK_MESSAGE(got == expected.str(), name << ": encoded bits differ from " << path);
+}
+
+// Send one command to a flexencode and collect the page it produces.
+static std::vector<unsigned char>
+flexencode_page(const std::string &cmd) {
+    // A single-entry channel map, so the block never needs to tag a retune
+    // (which would require a running flowgraph).
+    flexencode_impl blk(0, 0, 0, std::vector<double>(1, 931337500), 0, 0, "", 0, "", 0, 0, 0, false);
+    blk.beeps_message(pmt::cons(pmt::make_dict(), pmt::init_u8vector(cmd.length(), (const uint8_t *)cmd.c_str())));
+    return drain(blk);
+}
+
+static std::string
+hex_encode(const std::string &s) {
+    std::string hex;
+    for(size_t i = 0; i < s.length(); i++) {
+        char buf[3];
+        snprintf(buf, sizeof(buf), "%02x", (unsigned char)s[i]);
+        hex += buf;
+    }
+    return hex;
+}
+
+BOOST_AUTO_TEST_CASE(golden_pocencode)
+{
+    const unsigned int bauds[] = { 512, 1200, 2400 };
+    for(unsigned int baud : bauds) {
+        pocencode_impl num(pocencode::Numeric, baud, 1234567, numeric_msg, symrate, false);
+        check_golden("pocsag" + std::to_string(baud) + "_numeric", drain(num), symrate / baud);
+        pocencode_impl alpha(pocencode::Alpha, baud, 1615132, alpha_msg, symrate, false);
+        check_golden("pocsag" + std::to_string(baud) + "_alpha", drain(alpha), symrate / baud);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(golden_flexencode_pocsag)
+{
+    const unsigned int bauds[] = { 512, 1200, 2400 };
+    for(unsigned int baud : bauds) {
+        const std::string proto = "pocsag" + std::to_string(baud);
+        check_golden("server_" + proto + "_numeric",
+                flexencode_page(proto + " 0 931337500 numeric 1234567 " + hex_encode(numeric_msg)), symrate / baud);
+        check_golden("server_" + proto + "_alpha",
+                flexencode_page(proto + " 0 931337500 alpha 1615132 " + hex_encode(alpha_msg)), symrate / baud);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(golden_flexencode_flex)
+{
+    check_golden("flex_numeric",
+            flexencode_page("flex 0 931337500 numeric 1337000 " + hex_encode(numeric_msg)), symrate / 1600);
+    check_golden("flex_alpha",
+            flexencode_page("flex 0 931337500 alpha 1337000 " + hex_encode(alpha_msg)), symrate / 1600);
+}
+
+BOOST_AUTO_TEST_CASE(golden_gscencode)
+{
+    gscencode_impl alpha(gscencode::Alpha, 123456, alpha_msg, symrate, false);
+    check_golden("gsc_alpha", drain(alpha), symrate / 600);
+}
+
+BOOST_AUTO_TEST_CASE(golden_core)
+{
+    // The library encoder, without a block in the way, has to produce the
+    // same bits the blocks send.
+    struct { core::protocol_t protocol; core::msgtype_t type; uint32_t capcode; const std::string *msg; const char *golden; } cases[] = {
+        { core::FLEX, core::Alpha, 1337000, &alpha_msg, "flex_alpha" },
+        { core::FLEX, core::Numeric, 1337000, &numeric_msg, "flex_numeric" },
+        { core::POCSAG1200, core::Alpha, 1615132, &alpha_msg, "pocsag1200_alpha" },
+        { core::POCSAG512, core::Numeric, 1234567, &numeric_msg, "pocsag512_numeric" },
+        { core::GSC, core::Alpha, 123456, &alpha_msg, "gsc_alpha" },
+    };
+    for(const auto &c : cases) {
+        core::page pg;
+        pg.protocol = c.protocol;
+        pg.type = c.type;
+        pg.capcodes.push_back(c.capcode);
+        pg.message = *c.msg;
+        core::encoded_page enc;
+        std::string error;
+        BOOST_REQUIRE_MESSAGE(core::encode(pg, enc, &error), c.golden << ": " << error);
+        std::vector<unsigned char> syms(enc.nbits);
+        for(size_t i = 0; i < enc.nbits; i++) {
+            syms[i] = enc.bit(i) ? 1 : 0xff;
+        }
+        check_golden(c.golden, syms, 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(golden_flexencode_auto)
+{
+    // "auto" sends digits as numeric when that takes fewer code words, and
+    // anything else (or anything no shorter as numeric) as alpha.  POCSAG
+    // sends whole batches, so the digits have to be long enough to save one:
+    // 60 digits are 12 numeric words, in one batch with the address, or 22
+    // alpha words, which need a second batch.
+    std::string digits;
+    for(int i = 0; i < 6; i++) {
+        digits += "0123456789";
+    }
+    const std::string cmds[] = {
+        "pocsag1200 0 931337500 auto 1234560 " + hex_encode(digits),
+        "pocsag1200 1 931337500 auto 1615132 " + hex_encode(alpha_msg),
+        "flex 2 931337500 auto 1337000 " + hex_encode(numeric_msg),
+    };
+    const std::string same[] = {
+        "pocsag1200 0 931337500 numeric 1234560 " + hex_encode(digits),
+        "pocsag1200 1 931337500 alpha 1615132 " + hex_encode(alpha_msg),
+        "flex 2 931337500 alpha 1337000 " + hex_encode(numeric_msg),
+    };
+    flexencode_impl blk(0, 0, 0, std::vector<double>(1, 931337500), 0, 0, "", 0, "", 0, 0, 0, false);
+    std::vector<unsigned char> expected;
+    for(int i = 0; i < 3; i++) {
+        blk.beeps_message(pmt::cons(pmt::make_dict(), pmt::init_u8vector(cmds[i].length(), (const uint8_t *)cmds[i].c_str())));
+        const std::vector<unsigned char> page = flexencode_page(same[i]);
+        expected.insert(expected.end(), page.begin(), page.end());
+    }
+    BOOST_CHECK(drain(blk) == expected);
+
+    const pmt::pmt_t stats = blk.stats();
+    BOOST_CHECK_EQUAL(pmt::to_uint64(pmt::dict_ref(stats, pmt::mp("auto_numeric"), pmt::PMT_NIL)), 1u);
+    BOOST_CHECK_CLOSE(pmt::to_double(pmt::dict_ref(stats, pmt::mp("airtime_saved"), pmt::PMT_NIL)), 17 * 32 / 1200.0, 0.01);
+}
+
+BOOST_AUTO_TEST_CASE(golden_flexencode_cached)
+{
+    // The second page comes from the transmission cache, and has to be the
+    // same as the first.
+    flexencode_impl blk(0, 0, 0, std::vector<double>(1, 931337500), 0, 0, "", 1024 * 1024, "", 0, 0, 0, false);
+    for(int tag = 0; tag < 2; tag++) {
+        const std::string cmd = "flex " + std::to_string(tag) + " 931337500 alpha 1337000 " + hex_encode(alpha_msg);
+        blk.beeps_message(pmt::cons(pmt::make_dict(), pmt::init_u8vector(cmd.length(), (const uint8_t *)cmd.c_str())));
+    }
+    const std::vector<unsigned char> both = drain(blk);
+    BOOST_REQUIRE_EQUAL(both.size() % 2, 0u);
+    const std::vector<unsigned char> first(both.begin(), both.begin() + both.size() / 2);
+    BOOST_CHECK(std::equal(first.begin(), first.end(), both.begin() + both.size() / 2));
+    BOOST_CHECK_EQUAL(blk.cache_misses(), 1);
+    BOOST_CHECK_EQUAL(blk.cache_hits(), 1);
+    check_golden("flex_alpha", first, symrate / 1600);
+}
+
+BOOST_AUTO_TEST_CASE(golden_flexencode_threads)
+{
+    // Pages encoded on worker threads still come out in the order they were
+    // sent, each exactly as it would have been encoded on its own.
+    std::vector<std::string> cmds;
+    for(int tag = 0; tag < 16; tag++) {
+        if(tag % 2 == 0) {
+            cmds.push_back("pocsag512 " + std::to_string(tag) + " 931337500 alpha " + std::to_string(1615132 + tag) + " " + hex_encode(alpha_msg));
+        } else {
+            cmds.push_back("flex " + std::to_string(tag) + " 931337500 numeric " + std::to_string(1337000 + tag) + " " + hex_encode(numeric_msg));
+        }
+    }
+    std::vector<unsigned char> expected;
+    for(const auto &cmd : cmds) {
+        const std::vector<unsigned char> page = flexencode_page(cmd);
+        expected.insert(expected.end(), page.begin(), page.end());
+    }
+
+    flexencode_impl blk(0, 0, 0, std::vector<double>(1, 931337500), 0, 0, "", 0, "", 4, 0, 0, false);
+    blk.start();
+    for(const auto &cmd : cmds) {
+        blk.beeps_message(pmt::cons(pmt::make_dict(), pmt::init_u8vector(cmd.length(), (const uint8_t *)cmd.c_str())));
+    }
+    blk.stop();
+    BOOST_CHECK_EQUAL(blk.pages_accepted(), 16);
+    const std::vector<unsigned char> got = drain(blk);
+    BOOST_REQUIRE_EQUAL(got.size(), expected.size());
+    BOOST_CHECK(got == expected);
+}
+
+BOOST_AUTO_TEST_CASE(golden_flexencode_play)
+{
+    // Render a page to a play file, then play it back.
+    size_t nbits;
+    const std::vector<uint8_t> packed = pack_bits(
+            flexencode_page("flex 0 931337500 alpha 1337000 " + hex_encode(alpha_msg)), symrate / 1600, nbits);
+    uint8_t header[gr::mixalot::play_header_bytes];
+    gr::mixalot::make_play_header(1600, nbits, header);
+    char dir[] = "/tmp/mixalot_qa_XXXXXX";
+    BOOST_REQUIRE(mkdtemp(dir) != NULL);
+    const std::string path = std::string(dir) + "/page.bits";
+    const std::string shortpath = std::string(dir) + "/short.bits";
+    {
+        std::ofstream f(path.c_str(), std::ios::binary);
+        f.write((const char *)header, sizeof(header));
+        f.write((const char *)&packed[0], packed.size());
+        BOOST_REQUIRE(f.good());
+        // The header doesn't match the length.
+        std::ofstream s(shortpath.c_str(), std::ios::binary);
+        s.write((const char *)header, sizeof(header));
+        s.write((const char *)&packed[0], packed.size() - 1);
+        BOOST_REQUIRE(s.good());
+    }
+
+    flexencode_impl blk(0, 0, 0, std::vector<double>(1, 931337500), 0, 0, dir, 0, "", 0, 0, 0, false);
+    for(const std::string &cmd : { std::string("play 0 931337500 flex page.bits"),
+            // Nothing outside the playback directory, no file that's the
+            // wrong length or rendered at another baud rate.
+            std::string("play 1 931337500 flex ../page.bits"), std::string("play 2 931337500 flex short.bits"),
+            std::string("play 3 931337500 pocsag1200 page.bits") }) {
+        blk.beeps_message(pmt::cons(pmt::make_dict(), pmt::init_u8vector(cmd.length(), (const uint8_t *)cmd.c_str())));
+    }
+    BOOST_CHECK_EQUAL(blk.pages_rejected(), 3);
+    // A small file is copied when it's queued, so changing it afterwards
+    // doesn't matter.
+    BOOST_REQUIRE_EQUAL(truncate(path.c_str(), 0), 0);
+    check_golden("flex_alpha", drain(blk), symrate / 1600);
+
+    unlink(path.c_str());
+    unlink(shortpath.c_str());
+    rmdir(dir);
+}
@@ -0,0 +1,69 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_RECENT_SET_H
+#define INCLUDED_MIXALOT_RECENT_SET_H
+
+#include <stdint.h>
+#include <chrono>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+
+namespace gr {
+    namespace mixalot {
+
+        /**
+         * A set of 64-bit keys that forgets each key a fixed time after it
+         * was added, for turning away repeats of something seen recently.
+         * Keys are kept in a hash table, and in order of age so that old
+         * ones can be dropped from the front; insert() and erase() are O(1)
+         * amortized.  Not thread-safe.
+         */
+        class recent_set {
+        public:
+            typedef std::chrono::steady_clock clock;
+
+            explicit recent_set(double window_seconds)
+                : d_window(std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(window_seconds))) { }
+
+            // Add key, unless it was added less than the window ago; returns
+            // false if it was.
+            bool insert(uint64_t key, clock::time_point now) {
+                expire(now);
+                if(!d_added.emplace(key, now).second) {
+                    return false;
+                }
+                d_order.push_back(std::make_pair(now, key));
+                return true;
+            }
+
+            // Forget key early.
+            void erase(uint64_t key) { d_added.erase(key); }
+
+            size_t size() const { return d_added.size(); }
+
+        private:
+            void expire(clock::time_point now) {
+                while(!d_order.empty() && now - d_order.front().first >= d_window) {
+                    // Skip entries for keys erased (and maybe added again) since.
+                    auto it = d_added.find(d_order.front().second);
+                    if(it != d_added.end() && it->second == d_order.front().first) {
+                        d_added.erase(it);
+                    }
+                    d_order.pop_front();
+                }
+            }
+
+            clock::duration d_window;
+            std::unordered_map<uint64_t, clock::time_point> d_added;     // key -> when it was added
+            std::deque<std::pair<clock::time_point, uint64_t>> d_order;  // oldest first
+        };
+
+    } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_RECENT_SET_H */
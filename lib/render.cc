@@ -0,0 +1,119 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gnuradio/mixalot/render.h>
+#include <gnuradio/mixalot/core.h>
+#include <gnuradio/logger.h>
+#include <boost/algorithm/string.hpp>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include "utils.h"
+
+using std::string;
+using std::vector;
+
+namespace gr {
+    namespace mixalot {
+
+        bool
+        render_page(const std::string &cmd, core::encoded_page &encoded) {
+            string trimmed = boost::trim_copy(cmd);
+            vector<string> tokens;
+            boost::split(tokens, trimmed, boost::is_space(), boost::token_compress_on);
+            if(tokens.size() < 6) {
+                return false;
+            }
+            gr::logger logger("render_page");
+            core::page pg;
+            // flexencode sends FLEX and POCSAG only.
+            if(!core::parse_protocol(tokens[0], pg.protocol) || pg.protocol == core::GSC) {
+                return false;
+            }
+            if(tokens[3] == "alpha") {
+                pg.type = core::Alpha;
+            } else if(tokens[3] == "numeric") {
+                pg.type = core::Numeric;
+            } else if(tokens[3] == "auto") {
+                pg.type = core::Auto;
+            } else {
+                logger.warn("invalid type: {}", tokens[3]);
+                return false;
+            }
+            vector<string> capcodes;
+            boost::split(capcodes, tokens[4], boost::is_any_of(","), boost::token_compress_on);
+            for(const auto &capcode : capcodes) {
+                errno = 0;
+                const unsigned long code = strtoul(capcode.c_str(), 0, 10);
+                if(code > UINT32_MAX || ((code == ULONG_MAX || code == 0) && errno != 0)) {
+                    logger.warn("invalid capcode str: {}", tokens[4]);
+                    return false;
+                }
+                pg.capcodes.push_back(code);
+            }
+            pg.message = hex_decode(tokens[5]);
+
+            string error;
+            if(!core::encode(pg, encoded, &error)) {
+                logger.warn("can't encode page: {}", error);
+                return false;
+            }
+            return encoded.nbits > 0;
+        }
+
+        bool
+        render_command(const std::string &cmd, std::vector<int8_t> &symbols, unsigned int &baudrate) {
+            symbols.clear();
+            core::encoded_page encoded;
+            if(!render_page(cmd, encoded)) {
+                return false;
+            }
+            // Expand to render_symrate, as flexencode's work() does.
+            baudrate = encoded.baudrate;
+            const unsigned long sps = render_symrate / baudrate;
+            symbols.resize(encoded.nbits * sps);
+            for(size_t i = 0; i < encoded.nbits; i++) {
+                memset(&symbols[i * sps], encoded.bit(i) ? 1 : -1, sps);
+            }
+            return !symbols.empty();
+        }
+
+        static const char play_magic[4] = { 'M', 'X', 'P', 'B' };
+
+        void
+        make_play_header(unsigned int baudrate, uint64_t nbits, uint8_t *header) {
+            memcpy(header, play_magic, 4);
+            for(int i = 0; i < 4; i++) {
+                header[4 + i] = (baudrate >> (8 * i)) & 0xff;
+            }
+            for(int i = 0; i < 8; i++) {
+                header[8 + i] = (nbits >> (8 * i)) & 0xff;
+            }
+        }
+
+        bool
+        parse_play_header(const uint8_t *header, unsigned int &baudrate, uint64_t &nbits) {
+            if(memcmp(header, play_magic, 4) != 0) {
+                return false;
+            }
+            baudrate = 0;
+            for(int i = 3; i >= 0; i--) {
+                baudrate = (baudrate << 8) | header[4 + i];
+            }
+            nbits = 0;
+            for(int i = 7; i >= 0; i--) {
+                nbits = (nbits << 8) | header[8 + i];
+            }
+            return true;
+        }
+
+    } /* namespace mixalot */
+} /* namespace gr */
@@ -0,0 +1,153 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_TIMER_WHEEL_H
+#define INCLUDED_MIXALOT_TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace gr {
+    namespace mixalot {
+
+        /**
+         * Hierarchical timer wheel.  Time is in ticks; timers are kept in 4
+         * levels of 256 slots, each slot of a level spanning a whole turn
+         * of the level below, so 2^32 ticks ahead are covered (timers
+         * further out wait in the top level and are placed again when it
+         * comes around).  Inserting is O(1); advance() costs O(1) for each
+         * timer that expires or moves down a level, and skips the ticks in
+         * between.  Not thread-safe.
+         */
+        template<class T>
+        class timer_wheel {
+        public:
+            explicit timer_wheel(uint64_t now = 0) : d_now(now), d_size(0) { }
+
+            // Add a timer for tick when.  A timer that's already due expires
+            // on the next tick.
+            void insert(uint64_t when, T value) {
+                if(when <= d_now) {
+                    when = d_now + 1;
+                }
+                place(timer { when, std::move(value) });
+                d_size++;
+            }
+
+            // Move time forward to now, appending the values of the timers
+            // that expire to due, in order of expiry (and of insertion, for
+            // timers on the same tick).
+            void advance(uint64_t now, std::vector<T> &due) {
+                if(d_size == 0) {
+                    d_now = std::max(d_now, now);
+                    return;
+                }
+                while(d_now < now) {
+                    // Nothing happens until next_tick().
+                    d_now = std::max(d_now, std::min(now, next_tick()) - 1);
+                    d_now++;
+                    // Move the next turn of each level that's wrapped down,
+                    // highest first, then expire this tick's slot.
+                    for(int level = LEVELS - 1; level > 0; level--) {
+                        if((d_now & ((1ULL << (BITS * level)) - 1)) == 0) {
+                            cascade(level, (d_now >> (BITS * level)) & (SLOTS - 1));
+                        }
+                    }
+                    std::vector<timer> &slot = d_slots[0][d_now & (SLOTS - 1)];
+                    for(timer &t : slot) {
+                        due.push_back(std::move(t.value));
+                    }
+                    d_size -= slot.size();
+                    slot.clear();
+                    if(d_size == 0) {
+                        d_now = now;
+                    }
+                }
+            }
+
+            // Drop every timer whose value matches pred; returns how many.
+            // This looks at every timer, so it's O(n).
+            template<class Pred>
+            size_t remove_if(Pred pred) {
+                size_t removed = 0;
+                for(int level = 0; level < LEVELS; level++) {
+                    for(int i = 0; i < SLOTS; i++) {
+                        std::vector<timer> &slot = d_slots[level][i];
+                        const size_t before = slot.size();
+                        slot.erase(std::remove_if(slot.begin(), slot.end(),
+                                    [&pred](const timer &t) { return pred(t.value); }), slot.end());
+                        removed += before - slot.size();
+                    }
+                }
+                d_size -= removed;
+                return removed;
+            }
+
+            // The next tick at which advance() has something to do: a timer
+            // expires, or a slot of a higher level moves down.  The wheel
+            // mustn't be empty.  Looks at no more than a turn of each level.
+            uint64_t next_tick() const {
+                uint64_t next = UINT64_MAX;
+                for(int level = 0; level < LEVELS; level++) {
+                    const uint64_t turn = d_now >> (BITS * level);
+                    for(uint64_t i = 1; i <= SLOTS; i++) {
+                        const uint64_t at = (turn + i) << (BITS * level);
+                        if(at >= next) {
+                            break;
+                        }
+                        if(!d_slots[level][(turn + i) & (SLOTS - 1)].empty()) {
+                            next = at;
+                            break;
+                        }
+                    }
+                }
+                return next;
+            }
+
+            size_t size() const { return d_size; }
+            bool empty() const { return d_size == 0; }
+            uint64_t now() const { return d_now; }
+
+        private:
+            static const int LEVELS = 4;
+            static const int BITS = 8;
+            static const int SLOTS = 1 << BITS;
+
+            struct timer {
+                uint64_t when;
+                T value;
+            };
+
+            std::vector<timer> d_slots[LEVELS][SLOTS];
+            uint64_t d_now;                 // last tick advanced to
+            size_t d_size;
+
+            void place(timer &&t) {
+                // Beyond the top level, wait in its furthest slot.
+                const uint64_t delta = std::min<uint64_t>(t.when - d_now, (1ULL << (BITS * LEVELS)) - 1);
+                const uint64_t at = d_now + delta;
+                int level = 0;
+                while(level < LEVELS - 1 && delta >= (1ULL << (BITS * (level + 1)))) {
+                    level++;
+                }
+                d_slots[level][(at >> (BITS * level)) & (SLOTS - 1)].push_back(std::move(t));
+            }
+
+            void cascade(int level, unsigned int index) {
+                std::vector<timer> moving;
+                moving.swap(d_slots[level][index]);
+                for(timer &t : moving) {
+                    place(std::move(t));
+                }
+            }
+        };
+
+    } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_TIMER_WHEEL_H */
@@ -0,0 +1,45 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#include "trace_ring.h"
+#include <algorithm>
+#include <fstream>
+
+namespace gr {
+    namespace mixalot {
+
+        trace_ring::trace_ring(unsigned int depth) : d_mask(0), d_head(0) {
+            if(depth == 0) {
+                return;
+            }
+            size_t size = 1;
+            while(size < depth) {
+                size <<= 1;
+            }
+            d_records.resize(size);
+            d_mask = size - 1;
+        }
+
+        bool
+        trace_ring::dump(const std::string &filename) const {
+            std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+            if(!out) {
+                return false;
+            }
+            const uint64_t head = d_head.load(std::memory_order_relaxed);
+            const uint64_t count = std::min<uint64_t>(head, d_records.size());
+            const uint32_t version = 1;
+            out.write("MXTR", 4);
+            out.write((const char *)&version, sizeof(version));
+            out.write((const char *)&count, sizeof(count));
+            for(uint64_t i = head - count; i < head; i++) {
+                out.write((const char *)&d_records[i & d_mask], sizeof(trace_record));
+            }
+            return out.good();
+        }
+
+    } /* namespace mixalot */
+} /* namespace gr */
@@ -0,0 +1,78 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_TRACE_RING_H
+#define INCLUDED_MIXALOT_TRACE_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gr {
+    namespace mixalot {
+
+        // Trace event types.  a and b in the record depend on the event.
+        enum trace_event {
+            TRACE_ACCEPT = 1,       // page queued: chan, a = 0, b = sequence number
+            TRACE_REJECT = 2,       // command turned away: a = reject_reason
+            TRACE_ENCODE = 3,       // page encoded: a = microseconds
+            TRACE_PAGE_START = 4,   // page moved to the output: chan, b = sequence number
+            TRACE_ACK = 5,          // acks sent: a = number of pages acked
+            TRACE_WORK = 6,         // work() produced output: a = items
+            TRACE_DROP = 7,         // page dropped before going on the air: chan, a = drop_reason, b = sequence number (if it was queued)
+        };
+
+        struct trace_record {
+            uint64_t t_ns;          // steady_clock time, nanoseconds
+            uint16_t event;         // trace_event
+            uint16_t chan;
+            uint32_t a;
+            uint64_t b;
+        };
+
+        /**
+         * Fixed-size ring of binary trace records for post-mortem analysis.
+         * Recording is a clock read, an atomic increment and a 24-byte store,
+         * so it can stay on in production; the newest records overwrite the
+         * oldest.  A ring created with depth 0 records nothing.
+         *
+         * dump() writes a header (the 4 bytes "MXTR", a uint32_t version = 1
+         * and a uint64_t record count, host byte order) followed by the
+         * records, oldest first.  Records being written while dump() runs
+         * may come out torn.
+         */
+        class trace_ring {
+        public:
+            explicit trace_ring(unsigned int depth);
+
+            inline bool enabled() const { return !d_records.empty(); }
+            inline void record(trace_event event, unsigned int chan, uint32_t a, uint64_t b = 0) {
+                if(d_records.empty()) {
+                    return;
+                }
+                const uint64_t idx = d_head.fetch_add(1, std::memory_order_relaxed);
+                trace_record &r = d_records[idx & d_mask];
+                r.t_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count();
+                r.event = event;
+                r.chan = chan;
+                r.a = a;
+                r.b = b;
+            }
+            bool dump(const std::string &filename) const;
+
+        private:
+            std::vector<trace_record> d_records;
+            uint64_t d_mask;                    // d_records.size() - 1 (size is a power of two)
+            std::atomic<uint64_t> d_head;       // total records ever written
+        };
+
+    } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_TRACE_RING_H */
@@ -0,0 +1,182 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "transmission.h"
+#include <gnuradio/mixalot/render.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace gr {
+    namespace mixalot {
+
+        transmission::sptr
+        transmission::from_bits(std::vector<uint8_t> &&packed, size_t nbits, unsigned int baudrate) {
+            std::shared_ptr<transmission> tx(new transmission());
+            tx->d_bits = std::move(packed);
+            tx->d_data = tx->d_bits.data();
+            tx->d_nbits = std::min(nbits, tx->d_bits.size() * 8);
+            tx->d_baudrate = baudrate;
+            return tx;
+        }
+
+        transmission::sptr
+        transmission::from_file(const std::string &path, unsigned int baudrate) {
+            const int fd = open(path.c_str(), O_RDONLY);
+            if(fd < 0) {
+                throw std::runtime_error(path + ": " + strerror(errno));
+            }
+            struct stat st;
+            uint8_t header[play_header_bytes];
+            unsigned int filebaud;
+            uint64_t nbits;
+            if(fstat(fd, &st) != 0 || pread(fd, header, sizeof(header), 0) != (ssize_t)sizeof(header)
+                    || !parse_play_header(header, filebaud, nbits)) {
+                close(fd);
+                throw std::runtime_error(path + ": not a play file");
+            }
+            const size_t datalen = (size_t)st.st_size - play_header_bytes;
+            if(nbits == 0 || (nbits + 7) / 8 != datalen) {
+                close(fd);
+                throw std::runtime_error(path + ": header says " + std::to_string(nbits) + " bits, file has "
+                        + std::to_string(datalen) + " bytes");
+            }
+            if(filebaud != baudrate) {
+                close(fd);
+                throw std::runtime_error(path + ": rendered at " + std::to_string(filebaud) + " baud, not "
+                        + std::to_string(baudrate));
+            }
+
+            std::shared_ptr<transmission> tx(new transmission());
+            tx->d_nbits = nbits;
+            tx->d_baudrate = baudrate;
+            if(datalen <= PLAY_COPY_BYTES) {
+                // Small enough to copy, so the file can't change under us.
+                tx->d_bits.resize(datalen);
+                const ssize_t got = pread(fd, tx->d_bits.data(), datalen, play_header_bytes);
+                const int err = errno;
+                close(fd);
+                if(got != (ssize_t)datalen) {
+                    throw std::runtime_error(path + ": " + (got < 0 ? strerror(err) : "short read"));
+                }
+                tx->d_data = tx->d_bits.data();
+                return tx;
+            }
+            void *map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            const int err = errno;
+            close(fd);
+            if(map == MAP_FAILED) {
+                throw std::runtime_error(path + ": " + strerror(err));
+            }
+            // It's read once, front to back.
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            tx->d_map = map;
+            tx->d_maplen = st.st_size;
+            tx->d_data = (const uint8_t *)map + play_header_bytes;
+            return tx;
+        }
+
+        size_t
+        transmission::render(unsigned long sps, unsigned long pos, unsigned char *out, size_t n) const {
+            const unsigned long total = d_nbits * sps;
+            size_t produced = 0;
+            while(produced < n && pos < total) {
+                // Runs of the same symbol at a time.
+                const size_t run = std::min((size_t)(sps - pos % sps), n - produced);
+                memset(out + produced, bit(pos / sps) ? 1 : -1, run);
+                produced += run;
+                pos += run;
+            }
+            return produced;
+        }
+
+        void
+        transmission_queue::push(transmission::sptr tx) {
+            d_samples += tx->nbits() * (d_symrate / tx->baudrate());
+            d_queue.push_back(tx);
+        }
+
+        size_t
+        transmission_queue::read(unsigned char *out, size_t n) {
+            size_t produced = 0;
+            while(produced < n && !d_queue.empty()) {
+                const transmission &tx = *d_queue.front();
+                const unsigned long sps = d_symrate / tx.baudrate();
+                const size_t ret = tx.render(sps, d_pos, out + produced, n - produced);
+                produced += ret;
+                d_pos += ret;
+                if(d_pos == tx.nbits() * sps) {
+                    d_samples -= d_pos;
+                    d_pos = 0;
+                    d_queue.pop_front();
+                }
+            }
+            return produced;
+        }
+
+        transmission::~transmission() {
+            if(d_map != 0) {
+                munmap(d_map, d_maplen);
+            }
+        }
+
+        uint64_t
+        transmission_cache::hash(const std::string &key) {
+            uint64_t h = 0xcbf29ce484222325ULL;
+            for(unsigned char c : key) {
+                h ^= c;
+                h *= 0x100000001b3ULL;
+            }
+            return h;
+        }
+
+        transmission::sptr
+        transmission_cache::get(const std::string &key) {
+            auto it = d_index.find(hash(key));
+            if(it == d_index.end() || it->second->key != key) {
+                return transmission::sptr();
+            }
+            d_lru.splice(d_lru.begin(), d_lru, it->second);
+            return it->second->tx;
+        }
+
+        void
+        transmission_cache::erase(std::unordered_map<uint64_t, lru_list::iterator>::iterator it) {
+            d_bytes -= it->second->bytes;
+            d_lru.erase(it->second);
+            d_index.erase(it);
+        }
+
+        void
+        transmission_cache::put(const std::string &key, transmission::sptr tx) {
+            const size_t bytes = tx->memory() + key.size() + sizeof(entry);
+            if(bytes > d_max_bytes) {
+                return;
+            }
+            const uint64_t h = hash(key);
+            auto it = d_index.find(h);
+            if(it != d_index.end()) {
+                erase(it);
+            }
+            while(d_bytes + bytes > d_max_bytes) {
+                erase(d_index.find(d_lru.back().hash));
+            }
+            d_lru.push_front(entry { h, key, tx, bytes });
+            d_index[h] = d_lru.begin();
+            d_bytes += bytes;
+        }
+
+    } /* namespace mixalot */
+} /* namespace gr */
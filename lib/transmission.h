@@ -0,0 +1,134 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_TRANSMISSION_H
+#define INCLUDED_MIXALOT_TRANSMISSION_H
+
+#include <stdint.h>
+#include <deque>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gr {
+    namespace mixalot {
+
+        /**
+         * An encoded page, as packed bits: one bit per baud symbol, MSB first,
+         * 1 for a +1 symbol (the same format pagerenc -f bits writes).  The
+         * bits are either in memory or in a read-only mapping of a large
+         * pre-rendered file.  Transmissions never change once built, so one
+         * can be queued any number of times without copying; it's only
+         * expanded to output symbols in work().
+         */
+        class transmission {
+        public:
+            typedef std::shared_ptr<const transmission> sptr;
+
+            // Take ownership of packed bits.
+            static sptr from_bits(std::vector<uint8_t> &&packed, size_t nbits, unsigned int baudrate);
+            // Load a play file (see render.h) sent at baudrate.  Files up to
+            // PLAY_COPY_BYTES are read into memory; bigger ones are mapped,
+            // and must not be truncated or rewritten until the transmission
+            // is gone (a read past the end of the file is a SIGBUS).  Throws
+            // std::runtime_error if the file can't be read or its header
+            // doesn't match its size or baud rate.
+            static sptr from_file(const std::string &path, unsigned int baudrate);
+            static const size_t PLAY_COPY_BYTES = 4 << 20;
+
+            ~transmission();
+
+            inline bool bit(size_t i) const { return (d_data[i >> 3] >> (7 - (i & 7))) & 1; }
+            const uint8_t *data() const { return d_data; }
+            size_t nbits() const { return d_nbits; }
+            unsigned int baudrate() const { return d_baudrate; }
+            // Heap memory held (0 for a mapped file)
+            size_t memory() const { return d_bits.size(); }
+
+            /**
+             * Expand bits to output samples, starting pos samples in: each
+             * bit becomes sps samples of 1 or -1.  Writes at most n samples
+             * and returns how many it wrote (0 once the end is reached).
+             */
+            size_t render(unsigned long sps, unsigned long pos, unsigned char *out, size_t n) const;
+
+        private:
+            transmission() : d_data(0), d_nbits(0), d_baudrate(0), d_map(0), d_maplen(0) { }
+
+            const uint8_t *d_data;          // packed bits (d_bits or d_map)
+            size_t d_nbits;
+            unsigned int d_baudrate;
+            std::vector<uint8_t> d_bits;    // in-memory bits
+            void *d_map;                    // mapped file, if any
+            size_t d_maplen;
+        };
+
+        /**
+         * Transmissions waiting to be sent one after another, for the
+         * single-output encoder blocks.  Not thread-safe.
+         */
+        class transmission_queue {
+        public:
+            explicit transmission_queue(unsigned long symrate) : d_symrate(symrate), d_pos(0), d_samples(0) { }
+
+            void push(transmission::sptr tx);
+            bool empty() const { return d_queue.empty(); }
+            // Output samples not yet read
+            unsigned long samples() const { return d_samples - d_pos; }
+            // Read up to n output samples; returns how many were read.
+            size_t read(unsigned char *out, size_t n);
+
+        private:
+            unsigned long d_symrate;        // output sample rate
+            std::deque<transmission::sptr> d_queue;
+            unsigned long d_pos;            // samples of d_queue.front() already read
+            unsigned long d_samples;        // total samples in d_queue
+        };
+
+        /**
+         * LRU cache of recently encoded transmissions, so that a page that is
+         * sent again doesn't have to be encoded again.  Entries are indexed by
+         * a 64-bit hash of the key (a normalized command); the key itself is
+         * kept too, so a hash collision is just a miss.  The cache holds at
+         * most max_bytes of transmissions and keys (0 disables it).  Not
+         * thread-safe.
+         */
+        class transmission_cache {
+        public:
+            explicit transmission_cache(size_t max_bytes) : d_max_bytes(max_bytes), d_bytes(0) { }
+
+            // Returns an empty pointer on a miss.
+            transmission::sptr get(const std::string &key);
+            void put(const std::string &key, transmission::sptr tx);
+            size_t size() const { return d_lru.size(); }
+            size_t bytes() const { return d_bytes; }
+
+            // FNV-1a
+            static uint64_t hash(const std::string &key);
+
+        private:
+            struct entry {
+                uint64_t hash;
+                std::string key;
+                transmission::sptr tx;
+                size_t bytes;               // charged against d_max_bytes
+            };
+            typedef std::list<entry> lru_list;
+
+            size_t d_max_bytes;
+            size_t d_bytes;                 // total of entry::bytes
+            lru_list d_lru;                 // most recently used first
+            std::unordered_map<uint64_t, lru_list::iterator> d_index;
+
+            void erase(std::unordered_map<uint64_t, lru_list::iterator>::iterator it);
+        };
+
+    } // namespace mixalot
+} // namespace gr
+
+#endif /* INCLUDED_MIXALOT_TRANSMISSION_H */
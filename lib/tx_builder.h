@@ -0,0 +1,150 @@
+/* Written by Brandon Creighton <cstone@pobox.com>.
+ *
+ * This code is in the public domain; however, note that most of its
+ * dependent code, including GNU Radio, is not.
+ */
+
+#ifndef INCLUDED_MIXALOT_TX_BUILDER_H
+#define INCLUDED_MIXALOT_TX_BUILDER_H
+
+// The bit writer shared by the encoders in core.cc.  Everything that differs
+// between protocols at the bit level -- polarity, word size and bit order,
+// interleave depth, baud -- comes from a traits struct, so it's all settled
+// at compile time and the per-bit work inlines down to shifts into a 64-bit
+// accumulator.
+
+#include <gnuradio/mixalot/core.h>
+#include <stdint.h>
+
+namespace gr {
+    namespace mixalot {
+        namespace core {
+
+            struct flex_traits {
+                static constexpr unsigned int baud = 1600;
+                static constexpr bool inverted = false;         // a 1 bit is sent as +1
+                static constexpr bool lsb_first = false;        // words go out MSB first
+                static constexpr unsigned int word_bits = 32;
+                static constexpr unsigned int interleave_depth = 8;   // words per interleaved block
+            };
+
+            // POCSAG sends a code word's 1 bits as -1 symbols.
+            template<unsigned int Baud>
+            struct pocsag_traits {
+                static constexpr unsigned int baud = Baud;
+                static constexpr bool inverted = true;
+                static constexpr bool lsb_first = false;
+                static constexpr unsigned int word_bits = 32;
+                static constexpr unsigned int interleave_depth = 1;
+            };
+
+            // GSC words are Golay (23,12), sent LSB first; message blocks
+            // interleave 8 BCH(15,7) words.
+            struct gsc_traits {
+                static constexpr unsigned int baud = 600;
+                static constexpr bool inverted = false;
+                static constexpr bool lsb_first = true;
+                static constexpr unsigned int word_bits = 23;
+                static constexpr unsigned int interleave_depth = 8;
+            };
+
+            /**
+             * Appends a protocol's bits to an encoded_page.  The encoders
+             * write logical bits; the traits' polarity is applied here.
+             * finish() has to be called once everything is written.
+             */
+            template<class Traits>
+            class tx_builder {
+            public:
+                explicit tx_builder(encoded_page &out) : d_out(out), d_acc(0), d_nacc(0) {
+                    d_out.baudrate = Traits::baud;
+                    d_out.bits.reserve(1024);
+                }
+
+                // The low n bits of v (n <= 32), highest first.
+                inline void bits(uint32_t v, unsigned int n) {
+                    if(Traits::inverted) {
+                        v = ~v;
+                    }
+                    d_acc = (d_acc << n) | (v & (((uint64_t)1 << n) - 1));
+                    d_nacc += n;
+                    d_out.nbits += n;
+                    while(d_nacc >= 8) {
+                        d_nacc -= 8;
+                        d_out.bits.push_back((uint8_t)(d_acc >> d_nacc));
+                    }
+                }
+                inline void bit(bool b) { bits(b, 1); }
+
+                // n bits of 1010..., or 0101... if first is false.
+                void alternating(unsigned int n, bool first) {
+                    const uint32_t pat = first ? 0xAAAAAAAA : 0x55555555;
+                    for(; n >= 32; n -= 32) {
+                        bits(pat, 32);
+                    }
+                    if(n) {
+                        bits(pat >> (32 - n), n);
+                    }
+                }
+
+                // One code word in the protocol's bit order, with each bit sent
+                // Rep times.
+                template<unsigned int Rep = 1>
+                inline void word(uint32_t w) {
+                    if(Traits::lsb_first) {
+                        w = reverse(w, Traits::word_bits);
+                    }
+                    if(Rep == 1) {
+                        bits(w, Traits::word_bits);
+                    } else {
+                        for(int i = Traits::word_bits - 1; i >= 0; i--) {
+                            bits(((w >> i) & 1) ? ~0u : 0u, Rep);
+                        }
+                    }
+                    d_out.codewords++;
+                }
+
+                // interleave_depth words of Bits bits each: the first bit
+                // (in the protocol's bit order) of each word, then the second...
+                template<unsigned int Bits = Traits::word_bits>
+                inline void interleaved(const uint32_t *words) {
+                    for(unsigned int i = 0; i < Bits; i++) {
+                        const unsigned int shift = Traits::lsb_first ? i : Bits - 1 - i;
+                        uint32_t column = 0;
+                        for(unsigned int j = 0; j < Traits::interleave_depth; j++) {
+                            column = (column << 1) | ((words[j] >> shift) & 1);
+                        }
+                        bits(column, Traits::interleave_depth);
+                    }
+                    d_out.codewords += Traits::interleave_depth;
+                }
+
+                void counted(size_t ncodewords) { d_out.codewords += ncodewords; }
+
+                // Write out the last partial byte.
+                void finish() {
+                    if(d_nacc) {
+                        d_out.bits.push_back((uint8_t)(d_acc << (8 - d_nacc)));
+                        d_nacc = 0;
+                    }
+                }
+
+            private:
+                static inline uint32_t reverse(uint32_t w, unsigned int n) {
+                    uint32_t r = 0;
+                    for(unsigned int i = 0; i < n; i++) {
+                        r = (r << 1) | ((w >> i) & 1);
+                    }
+                    return r;
+                }
+
+                encoded_page &d_out;
+                uint64_t d_acc;                 // bits not yet in d_out.bits, newest lowest
+                unsigned int d_nacc;            // number of bits in d_acc (< 8 between calls)
+            };
+
+        } /* namespace core */
+    } /* namespace mixalot */
+} /* namespace gr */
+
+#endif /* INCLUDED_MIXALOT_TX_BUILDER_H */
@@ -2,13 +2,14 @@
 #include "config.h"
 #endif
 
-#include <itpp/comm/bch.h>
-#include <iostream>
-#include <sstream>
 #include <stdexcept>
 #include "utils.h"
 
-using namespace itpp;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MIXALOT_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
 using std::string;
 
 namespace gr {
@@ -22,28 +23,6 @@ namespace gr {
             return (0x6996 >> x) & 1;
         }
 
-        shared_ptr<itpp::bvec> 
-        get_vec(const string binstr) {
-            std::stringstream ss;
-            for(string::const_iterator it = binstr.begin(); it != binstr.end(); ++it) {
-                const char c = *it;
-                switch(c) {
-                    case '0':
-                        ss << "0 ";
-                        break;
-                    case '1':
-                        ss << "1 ";
-                        break;
-                    case ' ':
-                        break;
-                    default:
-                        std::cerr << "invalid value: " << (int)c << std::endl;
-                        throw std::invalid_argument("invalid character in bit vector string: expected 1, 0, or space");
-                }
-            }
-            shared_ptr<itpp::bvec> bp(new itpp::bvec(ss.str()));
-            return bp;
-        }
         uint32_t
         reverse_bits32(uint32_t x) {
             x = (((x & 0xaaaaaaaa) >> 1) | ((x & 0x55555555) << 1));
@@ -57,163 +36,326 @@ namespace gr {
         // BCH(31,21) codeword.  This is systematic encoding -- the data is left as a contiguous stream
         // of bits, shifted to the upper 21 bits of the result; these are followed by the 11-bit BCH ECC,
         // and finally the parity bit is the LSB.
-        uint32_t 
-        encodeword(uint32_t dw) {
-            static BCH bch(31,21,2,ivec("3 5 5 1"), true);
-            bvec b(21);
-            uint32_to_bvec(dw, b, 21);
-            assert((dw >> 11) == bvec_to_uint32(b));
-            b = bch.encode(b);
-            b.set_size(32, true);
-            uint32_t codeword = (bvec_to_uint32(b));
+        //
+        // The check bits are the remainder of the data (times x^10) divided by
+        // the generator x^10+x^9+x^8+x^6+x^5+x^3+1, worked out on bits 30..1.
+        static uint32_t
+        encodeword_poly(uint32_t dw) {
+            static const uint32_t BCH_POLY = 0x769;
+            const uint32_t data = dw & 0xFFFFF800;
+            uint32_t rem = data >> 1;
+            for(int i = 30; i >= 10; i--) {
+                if(rem & (1U << i)) {
+                    rem ^= BCH_POLY << (i - 10);
+                }
+            }
+            uint32_t codeword = data | (rem << 1);
             codeword |= (even_parity(codeword) & 1);
             return codeword;
         }
-        void 
-        uint32_to_bvec(uint32_t d, bvec &bv, int nbits) {
-            assert(nbits >= 0 && nbits < 33);
-            bv.zeros();
-            for(int i = 0; i < nbits; i++) {
-                bv(i) = ((d & 0x80000000) == 0x80000000) ? 1 : 0;
-                d = (d << 1);
+
+        namespace {
+            // The code (parity bit included) is linear, so a code word's low
+            // 11 bits are the XOR of those of its data bits' code words.
+            struct bch_encode_tables {
+                uint32_t bitcheck[32];          // check bits of each data bit (bits 11..31)
+                uint32_t bytecheck[3][256];     // check bits of each value of bits 31..24, 23..16, 15..11
+
+                bch_encode_tables() {
+                    for(int b = 0; b < 32; b++) {
+                        bitcheck[b] = (b >= 11) ? (encodeword_poly(1U << b) & 0x7ff) : 0;
+                    }
+                    for(int pos = 0; pos < 3; pos++) {
+                        for(int v = 0; v < 256; v++) {
+                            uint32_t check = 0;
+                            for(int b = 0; b < 8; b++) {
+                                if(v & (1 << b)) {
+                                    check ^= bitcheck[24 - pos * 8 + b];
+                                }
+                            }
+                            bytecheck[pos][v] = check;
+                        }
+                    }
+                }
+            };
+
+            const bch_encode_tables &
+            encode_tables() {
+                static const bch_encode_tables tables;
+                return tables;
+            }
+
+            inline uint32_t
+            encodeword_table(const bch_encode_tables &t, uint32_t dw) {
+                const uint32_t data = dw & 0xFFFFF800;
+                return data ^ t.bytecheck[0][data >> 24] ^ t.bytecheck[1][(data >> 16) & 0xff] ^ t.bytecheck[2][(data >> 8) & 0xff];
             }
-        }
 
+            void
+            encodewords_table(const uint32_t *in, uint32_t *out, size_t n) {
+                const bch_encode_tables &t = encode_tables();
+                for(size_t i = 0; i < n; i++) {
+                    out[i] = encodeword_table(t, in[i]);
+                }
+            }
+
+#ifdef MIXALOT_X86_DISPATCH
+            // Eight words per step: for each data bit, a lane mask of the
+            // words that have it set selects that bit's check bits.
+            __attribute__((target("avx2"))) void
+            encodewords_avx2(const uint32_t *in, uint32_t *out, size_t n) {
+                const bch_encode_tables &t = encode_tables();
+                const __m256i datamask = _mm256_set1_epi32(0xFFFFF800);
+                size_t i = 0;
+                for(; i + 8 <= n; i += 8) {
+                    const __m256i x = _mm256_loadu_si256((const __m256i *)(in + i));
+                    __m256i acc = _mm256_and_si256(x, datamask);
+                    __m256i shifted = x;
+                    for(int b = 31; b >= 11; b--) {
+                        const __m256i lanes = _mm256_srai_epi32(shifted, 31);
+                        acc = _mm256_xor_si256(acc, _mm256_and_si256(lanes, _mm256_set1_epi32(t.bitcheck[b])));
+                        shifted = _mm256_slli_epi32(shifted, 1);
+                    }
+                    _mm256_storeu_si256((__m256i *)(out + i), acc);
+                }
+                for(; i < n; i++) {
+                    out[i] = encodeword_table(t, in[i]);
+                }
+            }
+#endif
 
+            typedef void (*encodewords_fn)(const uint32_t *, uint32_t *, size_t);
 
-        uint32_t 
-        bvec_to_uint32(const bvec &bv) {
-            uint32_t u = 0;
-            for(unsigned int i = 0; i < (bv.length() > 32 ? 32 : bv.length()); i++) {
-                u <<= 1;
-                u = u | (bv(i) ? 1 : 0);
+            encodewords_fn
+            pick_encodewords() {
+#ifdef MIXALOT_X86_DISPATCH
+                __builtin_cpu_init();
+                if(__builtin_cpu_supports("avx2")) {
+                    return encodewords_avx2;
+                }
+#endif
+                return encodewords_table;
             }
-            return u;
         }
 
+        // encodeword_poly(), by table.
+        uint32_t
+        encodeword(uint32_t dw) {
+            return encodeword_table(encode_tables(), dw);
+        }
 
+        // Encode n datawords (as for encodeword()) at once, with the fastest
+        // implementation this CPU has.  in and out may be the same buffer.
+        void
+        encodewords(const uint32_t *in, uint32_t *out, size_t n) {
+            static const encodewords_fn fn = pick_encodewords();
+            fn(in, out, n);
+        }
 
-        #define MSG_BASE 0x33333333
-        void 
-        make_numeric_message(const std::string message, std::vector<uint32_t> &msgwords) {
-            int curpos = 0;
-            uint32_t msg = MSG_BASE;
-            for(int i = 0; i < message.length(); i++) {
-                char d = message[i];
-                uint32_t mbit = 0;
-                switch(d) {
-                    case ']':
-                    case ')':
-                        mbit = 7; 
-                        break;
-                    case 'S':
-                    case 'E':
-                        mbit = 5;
-                        break;
-                    case 'U':
-                        mbit = 0xd;
-                        break;
-                    case '-':
-                        mbit = 0xb;
-                        break;
-                    case '[':
-                    case '(':
-                        mbit = 0xf;
-                        break;
-                    case ' ':
-                        mbit = 3;
-                        break;
-                    case '0':
-                        mbit = 0;
-                        break;
-                    case '1':
-                        mbit = 8;
-                        break;
-                    case '2': 
-                        mbit = 4;
-                        break;
-                    case '3':
-                        mbit = 0xc;
-                        break;
-                    case '4':
-                        mbit = 2;
-                        break;
-                    case '5':
-                        mbit = 0xa;
-                        break;
-                    case '6':
-                        mbit = 6;
-                        break;
-                    case '7':
-                        mbit = 0xe;
-                        break;
-                    case '8':
-                        mbit = 1;
-                        break;
-                    case '9':
-                        mbit = 9;
-                        break;
-                    default:
-                        throw std::invalid_argument("non-digit character included in numeric message");
-                        break;
+        // The BCH(15,7) code GSC data blocks use (generator
+        // x^8+x^7+x^6+x^4+1).  info's 7 bits are sent LSB first, then the 8
+        // check bits; bit i of the result is the i-th bit sent.
+        uint32_t
+        encode_bch15_7(uint32_t info) {
+            static const uint32_t BCH_POLY = 0x1D1;
+            uint32_t rem = 0;
+            for(int i = 0; i < 7; i++) {
+                rem = (rem << 1) | ((info >> i) & 1);
+            }
+            rem <<= 8;
+            for(int i = 14; i >= 8; i--) {
+                if(rem & (1U << i)) {
+                    rem ^= BCH_POLY << (i - 8);
+                }
+            }
+            uint32_t codeword = info & 0x7f;
+            for(int i = 0; i < 8; i++) {
+                codeword |= ((rem >> (7 - i)) & 1) << (7 + i);
+            }
+            return codeword;
+        }
+
+        namespace {
+            // Syndrome decoding tables for the codewords made by encodeword().
+            // BCH(31,21) plus a parity bit has minimum distance 6, so every
+            // error pattern of up to two bits has its own syndrome.  The
+            // syndrome used here is the 11 check bits recomputed from the
+            // received data bits, XORed with the received check bits; since
+            // the code is linear this is the XOR of the syndromes of the
+            // individual bits in error, which are worked out with encodeword()
+            // itself so the tables always match the encoder.
+            struct bch_tables {
+                static const uint32_t NONE = 0xffffffff;
+                uint32_t bytesyn[4][256];       // syndrome of each byte value at each byte position
+                uint32_t errpattern[2048];      // syndrome -> error pattern, or NONE
+
+                bch_tables() {
+                    uint32_t bitsyn[32];
+                    for(int b = 0; b < 32; b++) {
+                        const uint32_t bit = 1U << b;
+                        bitsyn[b] = (b >= 11) ? (encodeword(bit) & 0x7ff) : bit;
+                    }
+                    for(int pos = 0; pos < 4; pos++) {
+                        for(int v = 0; v < 256; v++) {
+                            uint32_t syn = 0;
+                            for(int b = 0; b < 8; b++) {
+                                if(v & (1 << b)) {
+                                    syn ^= bitsyn[pos * 8 + b];
+                                }
+                            }
+                            bytesyn[pos][v] = syn;
+                        }
+                    }
+                    for(int i = 0; i < 2048; i++) {
+                        errpattern[i] = NONE;
+                    }
+                    errpattern[0] = 0;
+                    for(int i = 0; i < 32; i++) {
+                        errpattern[bitsyn[i]] = 1U << i;
+                        for(int j = i + 1; j < 32; j++) {
+                            errpattern[bitsyn[i] ^ bitsyn[j]] = (1U << i) | (1U << j);
+                        }
+                    }
                 }
-                msg <<= 4;
-                msg |= mbit;
-                curpos++;
-                if(curpos == 5) {
-                    const uint32_t msgtemp = (msg << 11) | 0x80000000;
-                    const uint32_t msgword = encodeword(msgtemp);
-                    assert((msgword & 0xFFFFF800) == msgtemp);      // sanity
-                    msgwords.push_back(msgword);
-                    curpos = 0;
-                    msg = MSG_BASE;
+
+                inline uint32_t syndrome(uint32_t cw) const {
+                    return bytesyn[0][cw & 0xff] ^ bytesyn[1][(cw >> 8) & 0xff]
+                        ^ bytesyn[2][(cw >> 16) & 0xff] ^ bytesyn[3][cw >> 24];
                 }
+            };
+        }
+
+        /**
+         * Check and correct a codeword made by encodeword().  Up to two bit
+         * errors are corrected; on success, corrected is set to the repaired
+         * codeword and nerrors to the number of bits that were wrong.  Returns
+         * false if the word has more errors than that.  Three errors are always
+         * detected; more may be miscorrected.
+         */
+        bool
+        decodeword(uint32_t cw, uint32_t &corrected, unsigned int &nerrors) {
+            static const bch_tables tables;
+            const uint32_t errors = tables.errpattern[tables.syndrome(cw)];
+            if(errors == bch_tables::NONE) {
+                return false;
             }
-            if(curpos > 0) {
-                for(; curpos < 5; curpos++) {
-                    msg <<= 4;
-                    msg |= 0x3;
+            corrected = cw ^ errors;
+            nerrors = __builtin_popcount(errors);
+            return true;
+        }
+
+        namespace {
+            // Character lookup tables for the POCSAG message packers.
+            struct pocsag_char_tables {
+                static const uint8_t INVALID = 0x10;
+                uint8_t numeric[256];       // 4-bit BCD code, bits reversed (INVALID if not sendable)
+                uint8_t alpha[128];         // 7-bit character, bits reversed (sent LSB first)
+
+                pocsag_char_tables() {
+                    static const char digits[] = "0123456789*U -)(";
+                    for(int c = 0; c < 256; c++) {
+                        numeric[c] = INVALID;
+                    }
+                    for(int v = 0; v < 16; v++) {
+                        if(v != 10) {       // 0xa is a spare code
+                            numeric[(uint8_t)digits[v]] = reverse_bits32(v) >> 28;
+                        }
+                    }
+                    numeric['S'] = numeric['E'] = reverse_bits32(0xa) >> 28;
+                    numeric[']'] = numeric[')'];
+                    numeric['['] = numeric['('];
+                    for(int c = 0; c < 128; c++) {
+                        alpha[c] = reverse_bits32(c) >> 25;
+                    }
                 }
-                const uint32_t msgtemp = (msg << 11) | 0x80000000;
-                const uint32_t msgword = encodeword(msgtemp);
-                assert((msgword & 0xFFFFF800) == msgtemp);      // sanity
-                msgwords.push_back(msgword);
+            };
+
+            const pocsag_char_tables &
+            char_tables() {
+                static const pocsag_char_tables tables;
+                return tables;
+            }
+
+            // A message word: the flag bit, then 20 data bits.
+            inline uint32_t
+            message_word(uint32_t data) {
+                return 0x80000000 | ((data & 0xfffff) << 11);
             }
         }
-        void 
-        make_alpha_message(const std::string message, std::vector<uint32_t> &msgwords) {
-            std::vector<bool> bitvec;
-            for(int i = 0; i < message.length(); i++) {
-                unsigned char c = (unsigned char)message[i];
-                for(int j = 0; j < 7; j++) {
-                    bitvec.push_back(c & 1);
-                    c >>= 1;
+
+        /**
+         * Pack a numeric message into POCSAG data words, five digits to a
+         * word, padded with spaces.  out needs room for
+         * numeric_message_words(len).  Returns false if the message has a
+         * character numeric pages can't send.
+         */
+        bool
+        pack_numeric_message(const char *msg, size_t len, uint32_t *out) {
+            const uint8_t *tbl = char_tables().numeric;
+            const uint32_t pad = tbl[(uint8_t)' '];
+            uint32_t bad = 0;
+            size_t i = 0;
+            for(; i + 5 <= len; i += 5) {
+                const uint32_t n0 = tbl[(uint8_t)msg[i]], n1 = tbl[(uint8_t)msg[i + 1]], n2 = tbl[(uint8_t)msg[i + 2]],
+                      n3 = tbl[(uint8_t)msg[i + 3]], n4 = tbl[(uint8_t)msg[i + 4]];
+                bad |= n0 | n1 | n2 | n3 | n4;
+                *out++ = message_word((n0 << 16) | (n1 << 12) | (n2 << 8) | (n3 << 4) | n4);
+            }
+            if(i < len) {
+                uint32_t data = 0;
+                for(size_t j = i; j < i + 5; j++) {
+                    const uint32_t n = j < len ? tbl[(uint8_t)msg[j]] : pad;
+                    bad |= n;
+                    data = (data << 4) | (n & 0xf);
                 }
+                *out++ = message_word(data);
             }
-            bitvec.push_back(3);     // EOT -- not required, but helps
-            unsigned int bc = 0;
-            uint32_t msg = 0;
-            for(std::vector<bool>::iterator bit = bitvec.begin(); bit != bitvec.end(); bit++) {
-                msg <<= 1;
-                msg |= *bit;
-                bc++;
-                if(bc == 20) {
-                    const uint32_t msgtemp = (msg << 11) | 0x80000000;
-                    const uint32_t msgword = encodeword(msgtemp);
-                    assert((msgword & 0xFFFFF800) == msgtemp);      // sanity
-                    msgwords.push_back(msgword);
-                    bc = 0;
-                    msg = 0;
+            return !(bad & pocsag_char_tables::INVALID);
+        }
+
+        /**
+         * Pack an alphanumeric message, and an EOT after it, into POCSAG data
+         * words: 7-bit characters, LSB first, run together 20 bits to a word.
+         * out needs room for alpha_message_words(len).
+         */
+        void
+        pack_alpha_message(const char *msg, size_t len, uint32_t *out) {
+            const uint8_t *tbl = char_tables().alpha;
+            uint64_t acc = 0;           // bits not yet written, newest lowest
+            unsigned int nacc = 0;
+            for(size_t i = 0; i <= len; i++) {
+                const uint8_t c = i < len ? msg[i] : 0x04;
+                acc = (acc << 7) | tbl[c & 0x7f];
+                nacc += 7;
+                if(nacc >= 20) {
+                    nacc -= 20;
+                    *out++ = message_word(acc >> nacc);
                 }
             }
-            if(bc > 0) {
-                msg <<= (20-bc);
-                const uint32_t msgtemp = (msg << 11) | 0x80000000;
-                const uint32_t msgword = encodeword(msgtemp);
-                assert((msgword & 0xFFFFF800) == msgtemp);      // sanity
-                msgwords.push_back(msgword);
+            if(nacc > 0) {
+                *out++ = message_word(acc << (20 - nacc));
             }
         }
+
+        void
+        make_numeric_message(const std::string message, std::vector<uint32_t> &msgwords) {
+            const size_t first = msgwords.size();
+            msgwords.resize(first + numeric_message_words(message.length()));
+            if(!pack_numeric_message(message.data(), message.length(), msgwords.data() + first)) {
+                msgwords.resize(first);
+                throw std::invalid_argument("non-digit character included in numeric message");
+            }
+            encodewords(msgwords.data() + first, msgwords.data() + first, msgwords.size() - first);
+        }
+
+        void
+        make_alpha_message(const std::string message, std::vector<uint32_t> &msgwords) {
+            const size_t first = msgwords.size();
+            msgwords.resize(first + alpha_message_words(message.length()));
+            pack_alpha_message(message.data(), message.length(), msgwords.data() + first);
+            encodewords(msgwords.data() + first, msgwords.data() + first, msgwords.size() - first);
+        }
+
         /**
          * Decode from %02x-style hex string (41414141) to ASCII (AAAA).
          * Lossy; this drops nulls and ignores invalid chars.
@@ -253,26 +395,6 @@ namespace gr {
 
             return outmsg;
         }
-
-        void
-        uint32_to_bvec_rev(uint32_t d, bvec &bv, int nbits) {
-            assert(nbits >= 0 && nbits < 33);
-            bv.zeros();
-            for(int i = 0; i < nbits; i++) {
-                bv(i) = (d & 1);
-                d = (d >> 1);
-            }
-        }
-
-        /**
-         * Invert bvin, replacing bvout with an inverted version.
-         */
-        void
-        invert_bvec(const bvec &bvin, bvec &bvout) {
-            for(unsigned int i = 0; i < bvin.size(); i++) {
-                bvout(i) = bvin(i) == 0 ? 1 : 0;
-            }
-        }
     }
 }
 
@@ -2,29 +2,30 @@
 #include "config.h"
 #endif
 
-#include <gnuradio/types.h>
-#include <gnuradio/io_signature.h>
-#include <itpp/comm/bch.h>
+// Code word and message helpers shared by the encoders and decoders.  Part
+// of mixalot-core, so no GNU Radio here.
+
+#include <stddef.h>
 #include <stdint.h>
-#include <iostream>
-#include <sstream>
+#include <string>
 #include <vector>
 
-using std::shared_ptr;
-using itpp::bvec;
 namespace gr {
     namespace mixalot {
-        shared_ptr<itpp::bvec> get_vec(const std::string binstr);
         void make_numeric_message(const std::string message, std::vector<uint32_t> &msgwords);
         void make_alpha_message(const std::string message, std::vector<uint32_t> &msgwords);
+        bool pack_numeric_message(const char *msg, size_t len, uint32_t *out);
+        void pack_alpha_message(const char *msg, size_t len, uint32_t *out);
+        // POCSAG message words needed for a message of len characters.
+        inline size_t numeric_message_words(size_t len) { return (len + 4) / 5; }
+        inline size_t alpha_message_words(size_t len) { return ((len + 1) * 7 + 19) / 20; }    // with the EOT
         uint32_t encodeword(uint32_t dw);
-        void uint32_to_bvec(uint32_t d, bvec &bv, int nbits = 32);
+        void encodewords(const uint32_t *in, uint32_t *out, size_t n);
+        bool decodeword(uint32_t cw, uint32_t &corrected, unsigned int &nerrors);
+        uint32_t encode_bch15_7(uint32_t info);
         uint32_t reverse_bits32(uint32_t x);
-        uint32_t bvec_to_uint32(const bvec &bv);
         unsigned char even_parity(uint32_t x);
         std::string hex_decode(std::string const &message);
-        void uint32_to_bvec_rev(uint32_t d, bvec &bv, int nbits=32);
-        void invert_bvec(const bvec &bvin, bvec &bvout);
     }
 }
 
@@ -24,4 +24,34 @@
 
  static const char *__doc_gr_mixalot_flexencode_make = R"doc()doc";
 
+
+ static const char *__doc_gr_mixalot_flexencode_pages_accepted = R"doc()doc";
+
+
+ static const char *__doc_gr_mixalot_flexencode_pages_rejected = R"doc()doc";
+
+
+ static const char *__doc_gr_mixalot_flexencode_codewords_encoded = R"doc()doc";
+
+
+ static const char *__doc_gr_mixalot_flexencode_queued_samples = R"doc()doc";
+
+
+ static const char *__doc_gr_mixalot_flexencode_queued_airtime = R"doc()doc";
+
+
+ static const char *__doc_gr_mixalot_flexencode_idle_work_calls = R"doc()doc";
+
+
+ static const char *__doc_gr_mixalot_flexencode_cache_hits = R"doc()doc";
+
+
+ static const char *__doc_gr_mixalot_flexencode_cache_misses = R"doc()doc";
+
+
+ static const char *__doc_gr_mixalot_flexencode_stats = R"doc()doc";
+
+
+ static const char *__doc_gr_mixalot_flexencode_dump_trace = R"doc()doc";
+
   
@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(flexencode.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(fbfa76c4205df7022acd8e4bdd316121)                     */
+/* BINDTOOL_HEADER_FILE_HASH(0e62add4c6fd8878252b9fffce956fc7)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -37,10 +37,73 @@ void bind_flexencode(py::module& m)
         std::shared_ptr<flexencode>>(m, "flexencode", D(flexencode))
 
         .def(py::init(&flexencode::make),
+           py::arg("max_queue_seconds") = 600.0,
+           py::arg("max_queue_pages") = 1000,
+           py::arg("max_queue_bytes") = 256 * 1024 * 1024,
+           py::arg("channel_freqs") = std::vector<double>(),
+           py::arg("stats_interval") = 0.0,
+           py::arg("trace_depth") = 0,
+           py::arg("playback_dir") = "",
+           py::arg("cache_bytes") = 16 * 1024 * 1024,
+           py::arg("journal_path") = "",
+           py::arg("encode_threads") = 0,
+           py::arg("page_ttl") = 0.0,
+           py::arg("dedup_window") = 0.0,
+           py::arg("retune_messages") = false,
            D(flexencode,make)
         )
         
 
+        .def("pages_accepted",&flexencode::pages_accepted,
+            D(flexencode,pages_accepted)
+        )
+
+
+        .def("pages_rejected",&flexencode::pages_rejected,
+            D(flexencode,pages_rejected)
+        )
+
+
+        .def("codewords_encoded",&flexencode::codewords_encoded,
+            D(flexencode,codewords_encoded)
+        )
+
+
+        .def("queued_samples",&flexencode::queued_samples,
+            D(flexencode,queued_samples)
+        )
+
+
+        .def("queued_airtime",&flexencode::queued_airtime,
+            D(flexencode,queued_airtime)
+        )
+
+
+        .def("idle_work_calls",&flexencode::idle_work_calls,
+            D(flexencode,idle_work_calls)
+        )
+
+
+        .def("cache_hits",&flexencode::cache_hits,
+            D(flexencode,cache_hits)
+        )
+
+
+        .def("cache_misses",&flexencode::cache_misses,
+            D(flexencode,cache_misses)
+        )
+
+
+        .def("stats",&flexencode::stats,
+            D(flexencode,stats)
+        )
+
+
+        .def("dump_trace",&flexencode::dump_trace,
+            py::arg("filename"),
+            D(flexencode,dump_trace)
+        )
+
 
 
         ;
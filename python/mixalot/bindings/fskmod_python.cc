@@ -0,0 +1,66 @@
+/*
+ * Copyright 2022 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+/***********************************************************************************/
+/* This file is automatically generated using bindtool and can be manually edited  */
+/* The following lines can be configured to regenerate this file during cmake      */
+/* If manual edits are made, the following tags should be modified accordingly.    */
+/* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
+/* BINDTOOL_USE_PYGCCXML(0)                                                        */
+/* BINDTOOL_HEADER_FILE(fskmod.h)                                          */
+/* BINDTOOL_HEADER_FILE_HASH(5c28f13ff8711c272e0d7517328eb03b)                     */
+/***********************************************************************************/
+
+#include <pybind11/complex.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+
+#include <gnuradio/mixalot/fskmod.h>
+// pydoc.h is automatically generated in the build directory
+#include <fskmod_pydoc.h>
+
+void bind_fskmod(py::module& m)
+{
+
+    using fskmod    = ::gr::mixalot::fskmod;
+
+
+    py::class_<fskmod, gr::sync_interpolator, gr::sync_block, gr::block, gr::basic_block,
+        std::shared_ptr<fskmod>>(m, "fskmod", D(fskmod))
+
+        .def(py::init(&fskmod::make),
+           py::arg("samp_rate") = 998400,
+           py::arg("interpolation") = 26,
+           py::arg("deviation") = 4800.0,
+           py::arg("shaping") = 0,
+           py::arg("bt") = 0.5,
+           py::arg("baudrate") = 1600,
+           py::arg("amplitude") = 1.0,
+           D(fskmod,make)
+        )
+        
+
+
+
+        ;
+
+
+
+
+}
+
+
+
+
+
+
+
+
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2022 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+/***********************************************************************************/
+/* This file is automatically generated using bindtool and can be manually edited  */
+/* The following lines can be configured to regenerate this file during cmake      */
+/* If manual edits are made, the following tags should be modified accordingly.    */
+/* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
+/* BINDTOOL_USE_PYGCCXML(0)                                                        */
+/* BINDTOOL_HEADER_FILE(fsksynth.h)                                        */
+/* BINDTOOL_HEADER_FILE_HASH(914cb5a287805d9884c496be3bb903d1)                     */
+/***********************************************************************************/
+
+#include <pybind11/complex.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+
+#include <gnuradio/mixalot/fsksynth.h>
+// pydoc.h is automatically generated in the build directory
+#include <fsksynth_pydoc.h>
+
+void bind_fsksynth(py::module& m)
+{
+
+    using fsksynth    = ::gr::mixalot::fsksynth;
+
+
+    py::class_<fsksynth, gr::sync_interpolator, gr::sync_block, gr::block, gr::basic_block,
+        std::shared_ptr<fsksynth>>(m, "fsksynth", D(fsksynth))
+
+        .def(py::init(&fsksynth::make),
+           py::arg("samp_rate") = 998400,
+           py::arg("interpolation") = 26,
+           py::arg("freq_offsets") = std::vector<double>(1, 0.0),
+           py::arg("deviation") = 4800.0,
+           D(fsksynth,make)
+        )
+        
+
+
+
+        ;
+
+
+
+
+}
+
+
+
+
+
+
+
+
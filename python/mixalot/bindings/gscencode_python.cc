@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(gscencode.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(62c0a17686b3c462993ecfed99ffbd1b)                     */
+/* BINDTOOL_HEADER_FILE_HASH(becbaa11e5bb20de66ea4f5d496174b6)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -41,6 +41,7 @@ void bind_gscencode(py::module& m)
            py::arg("capcode") = 0,
            py::arg("message") = "",
            py::arg("symrate") = 38400,
+           py::arg("persistent") = false,
            D(gscencode,make)
         )
         
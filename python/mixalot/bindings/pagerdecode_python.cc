@@ -0,0 +1,75 @@
+/*
+ * Copyright 2022 Free Software Foundation, Inc.
+ *
+ * This file is part of GNU Radio
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+/***********************************************************************************/
+/* This file is automatically generated using bindtool and can be manually edited  */
+/* The following lines can be configured to regenerate this file during cmake      */
+/* If manual edits are made, the following tags should be modified accordingly.    */
+/* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
+/* BINDTOOL_USE_PYGCCXML(0)                                                        */
+/* BINDTOOL_HEADER_FILE(pagerdecode.h)                                          */
+/* BINDTOOL_HEADER_FILE_HASH(a0f0bc60c3727eb1e589febaa2160289)                     */
+/***********************************************************************************/
+
+#include <pybind11/complex.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+
+#include <gnuradio/mixalot/pagerdecode.h>
+// pydoc.h is automatically generated in the build directory
+#include <pagerdecode_pydoc.h>
+
+void bind_pagerdecode(py::module& m)
+{
+
+    using pagerdecode    = ::gr::mixalot::pagerdecode;
+
+
+    py::class_<pagerdecode, gr::sync_block, gr::block, gr::basic_block,
+        std::shared_ptr<pagerdecode>>(m, "pagerdecode", D(pagerdecode))
+
+        .def(py::init(&pagerdecode::make),
+           py::arg("symrate") = 38400,
+           py::arg("pocsag") = true,
+           py::arg("flex") = true,
+           py::arg("gsc") = true,
+           D(pagerdecode,make)
+        )
+        
+
+        .def("pages_decoded",&pagerdecode::pages_decoded,
+            D(pagerdecode,pages_decoded)
+        )
+
+
+        .def("corrected_errors",&pagerdecode::corrected_errors,
+            D(pagerdecode,corrected_errors)
+        )
+
+
+        .def("uncorrectable_words",&pagerdecode::uncorrectable_words,
+            D(pagerdecode,uncorrectable_words)
+        )
+
+        ;
+
+
+
+
+}
+
+
+
+
+
+
+
+
@@ -14,7 +14,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0)                                                       */
 /* BINDTOOL_USE_PYGCCXML(0)                                                        */
 /* BINDTOOL_HEADER_FILE(pocencode.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(f65296c61185cce6f1b83f21ad3ab162)                     */
+/* BINDTOOL_HEADER_FILE_HASH(7e61e025f96358233c99c57e00aff45d)                     */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -42,6 +42,7 @@ void bind_pocencode(py::module& m)
            py::arg("capcode") = 0,
            py::arg("message") = "",
            py::arg("symrate") = 38400,
+           py::arg("persistent") = false,
            D(pocencode,make)
         )
         
@@ -22,7 +22,10 @@ namespace py = pybind11;
 /**************************************/
 // BINDING_FUNCTION_PROTOTYPES(
 void bind_flexencode(py::module& m);
+void bind_fsksynth(py::module& m);
+void bind_fskmod(py::module& m);
 void bind_gscencode(py::module& m);
+void bind_pagerdecode(py::module& m);
 void bind_pocencode(py::module& m);
 // ) END BINDING_FUNCTION_PROTOTYPES
 
@@ -53,7 +56,10 @@ PYBIND11_MODULE(mixalot_python, m)
     /**************************************/
     // BINDING_FUNCTION_CALLS(
     bind_flexencode(m);
+    bind_fsksynth(m);
+    bind_fskmod(m);
     bind_gscencode(m);
+    bind_pagerdecode(m);
     bind_pocencode(m);
     // ) END BINDING_FUNCTION_CALLS
 }